@@ -1,20 +1,21 @@
+#define _GNU_SOURCE  // RUSAGE_THREAD
 #define _DEFAULT_SOURCE
 #define _POSIX_C_SOURCE 200809L
 
 #include "audio.h"
 #include "config.h"
+#include <errno.h>
+#include <math.h>
 #include <opus/opusfile.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
 #include <time.h>
-
-// Debug: Track callback timing
-// static FILE *debug_log = NULL;
-// static struct timespec debug_start_time = {0};
-// static struct timespec debug_last_log_time = {0};
-// static uint64_t debug_callback_count = 0;
-// static uint64_t debug_last_callback_count = 0;
+#include <unistd.h>
 
 static inline float clamp1(float x) {
   if (x < -1.0f) return -1.0f;
@@ -22,34 +23,229 @@ static inline float clamp1(float x) {
   return x;
 }
 
+// Sample bank for one-shot effects, synthesized once at startup so the
+// callback only ever reads pre-decoded stereo PCM.
+typedef struct {
+  float *pcm;
+  uint64_t frames;
+} SfxSample;
+
+static SfxSample g_sfx_bank[SFX_COUNT];
+static int g_sfx_bank_rate = 0;
+
+// Out of memory leaves the sample empty; triggering it then plays nothing
+static void sfx_synth(SfxSample *smp, int sample_rate, double duration,
+                      double f0, double f1, double decay, double noise) {
+  uint64_t frames = (uint64_t)(duration * sample_rate);
+  float *pcm = (float *)malloc((size_t)frames * 2 * sizeof(float));
+  if (!pcm) {
+    fprintf(stderr, "Out of memory for a sound effect; it will be silent\n");
+    smp->pcm = NULL;
+    smp->frames = 0;
+    return;
+  }
+  uint32_t seed = 0x2545F491u;
+  double phase = 0.0;
+  for (uint64_t i = 0; i < frames; i++) {
+    double t = (double)i / sample_rate;
+    double k = (double)i / (double)frames;
+    double freq = f0 + (f1 - f0) * k;  // Linear pitch sweep
+    phase += 2.0 * M_PI * freq / sample_rate;
+    seed = seed * 1664525u + 1013904223u;
+    double n = ((double)(seed >> 8) / 8388608.0) - 1.0;
+    double env = exp(-t * decay);
+    // Short linear attack avoids a click at the start of the sample
+    if (i < 64)
+      env *= (double)i / 64.0;
+    double v = (sin(phase) * (1.0 - noise) + n * noise) * env;
+    pcm[i * 2 + 0] = (float)v;
+    pcm[i * 2 + 1] = (float)v;
+  }
+  smp->pcm = pcm;
+  smp->frames = frames;
+}
+
+static void sfx_bank_init(int sample_rate) {
+  if (g_sfx_bank_rate == sample_rate)
+    return;
+  for (int i = 0; i < SFX_COUNT; i++)
+    free(g_sfx_bank[i].pcm);
+
+  // Low falling thud with some grit
+  sfx_synth(&g_sfx_bank[SFX_MISS], sample_rate, 0.12, 140.0, 60.0, 30.0, 0.35);
+  // Bright rising sweep
+  sfx_synth(&g_sfx_bank[SFX_STAR_POWER], sample_rate, 0.45, 660.0, 1760.0, 6.0, 0.0);
+  // Very short high blip
+  sfx_synth(&g_sfx_bank[SFX_MENU_TICK], sample_rate, 0.02, 2200.0, 2200.0, 250.0, 0.0);
+  g_sfx_bank_rate = sample_rate;
+}
+
+static void sfx_mixer_reset(SfxMixer *m) {
+  atomic_init(&m->head, 0);
+  atomic_init(&m->tail, 0);
+  for (int v = 0; v < SFX_MAX_VOICES; v++)
+    m->voices[v].id = -1;
+}
+
+void audio_sfx_play(AudioEngine *e, SfxId id, float gain) {
+  SfxMixer *m = &e->sfx;
+  uint32_t head = atomic_load_explicit(&m->head, memory_order_relaxed);
+  uint32_t tail = atomic_load_explicit(&m->tail, memory_order_acquire);
+  if (head - tail >= SFX_QUEUE_SIZE)
+    return;  // Callback is behind; dropping beats blocking the game loop
+  m->queue[head & (SFX_QUEUE_SIZE - 1)] = (SfxTrigger){.id = (uint8_t)id, .gain = gain};
+  atomic_store_explicit(&m->head, head + 1, memory_order_release);
+}
+
+// Audio thread only: move queued triggers into voices and add them to out
+static void sfx_mix(SfxMixer *m, float *out, int frames) {
+  uint32_t tail = atomic_load_explicit(&m->tail, memory_order_relaxed);
+  uint32_t head = atomic_load_explicit(&m->head, memory_order_acquire);
+  while (tail != head) {
+    SfxTrigger trig = m->queue[tail & (SFX_QUEUE_SIZE - 1)];
+    tail++;
+    if (g_sfx_bank[trig.id].frames == 0)
+      continue;
+
+    // Take a free voice, or steal the one with the fewest frames left
+    int slot = 0;
+    uint64_t best_left = UINT64_MAX;
+    for (int v = 0; v < SFX_MAX_VOICES; v++) {
+      if (m->voices[v].id < 0) {
+        slot = v;
+        break;
+      }
+      uint64_t left = g_sfx_bank[m->voices[v].id].frames - m->voices[v].pos;
+      if (left < best_left) {
+        best_left = left;
+        slot = v;
+      }
+    }
+    m->voices[slot].id = trig.id;
+    m->voices[slot].pos = 0;
+    m->voices[slot].gain = trig.gain;
+  }
+  atomic_store_explicit(&m->tail, tail, memory_order_release);
+
+  for (int v = 0; v < SFX_MAX_VOICES; v++) {
+    SfxVoice *vo = &m->voices[v];
+    if (vo->id < 0)
+      continue;
+    const SfxSample *smp = &g_sfx_bank[vo->id];
+    uint64_t left = smp->frames - vo->pos;
+    int n = (left < (uint64_t)frames) ? (int)left : frames;
+    const float *src = smp->pcm + vo->pos * 2;
+    for (int f = 0; f < n * 2; f++)
+      out[f] += src[f] * vo->gain;
+    vo->pos += (uint64_t)n;
+    if (vo->pos >= smp->frames)
+      vo->id = -1;
+  }
+}
+
+static inline uint64_t mono_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline int hist_bucket(uint64_t ns) {
+  uint64_t us = ns / 1000;
+  int b = us ? 64 - __builtin_clzll(us) : 0;
+  return b < AUDIO_HIST_BUCKETS ? b : AUDIO_HIST_BUCKETS - 1;
+}
+
+static inline void atomic_max_u64(_Atomic uint64_t *dst, uint64_t v) {
+  uint64_t cur = atomic_load_explicit(dst, memory_order_relaxed);
+  if (v > cur)
+    atomic_store_explicit(dst, v, memory_order_relaxed);  // Single writer
+}
+
+// Record the interval since the previous callback and check the deadline.
+// The device drains one buffer per period, so each callback is due one
+// period after the previous deadline; early (bursty) callbacks are fine.
+static void audio_stats_begin(AudioStats *st, uint64_t now, int frames, int sample_rate) {
+  uint64_t period = (uint64_t)frames * 1000000000ull / (uint64_t)sample_rate;
+  if (st->last_cb_ns) {
+    uint64_t interval = now - st->last_cb_ns;
+    atomic_fetch_add_explicit(&st->interval_hist[hist_bucket(interval)], 1, memory_order_relaxed);
+    atomic_max_u64(&st->interval_max_ns, interval);
+
+    if (now > st->deadline_ns + period) {
+      atomic_fetch_add_explicit(&st->underruns, 1, memory_order_relaxed);
+      st->deadline_ns = now;  // Resync after the gap
+    } else if (now > st->deadline_ns) {
+      atomic_fetch_add_explicit(&st->late, 1, memory_order_relaxed);
+    }
+    st->deadline_ns += period;
+  } else {
+    st->deadline_ns = now + period;
+  }
+  st->last_cb_ns = now;
+  atomic_fetch_add_explicit(&st->callbacks, 1, memory_order_relaxed);
+}
+
+static void audio_stats_end(AudioStats *st, uint64_t start) {
+  uint64_t exec = mono_ns() - start;
+  atomic_fetch_add_explicit(&st->exec_hist[hist_bucket(exec)], 1, memory_order_relaxed);
+  atomic_max_u64(&st->exec_max_ns, exec);
+}
+
+// Page faults of this thread alone: the render, input and terminal threads
+// fault on their own and would hide whether the audio path did.
+static void audio_sample_faults(AudioEngine *e) {
+  AudioStats *st = &e->stats;
+  if (st->fault_countdown-- > 0)
+    return;
+  st->fault_countdown = AUDIO_FAULT_SAMPLE_CALLBACKS - 1;
+  struct rusage ru;
+  if (getrusage(RUSAGE_THREAD, &ru) != 0)
+    return;
+  SDL_threadID self = SDL_ThreadID();
+  if (self == st->fault_thread && e->started) {
+    atomic_fetch_add_explicit(&st->minflt, (uint64_t)(ru.ru_minflt - st->fault_min_seen),
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&st->majflt, (uint64_t)(ru.ru_majflt - st->fault_maj_seen),
+                              memory_order_relaxed);
+  }
+  st->fault_thread = self;
+  st->fault_min_seen = ru.ru_minflt;
+  st->fault_maj_seen = ru.ru_majflt;
+}
+
+// Runs on the callback thread itself: SDL does not expose its audio thread,
+// so this is the only place the priority can be changed.
+static void audio_apply_rt_priority(AudioEngine *e) {
+  struct sched_param sp = {.sched_priority = AUDIO_RT_PRIORITY};
+  int state;
+  if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp) == 0)
+    state = AUDIO_RT_FIFO;
+  else if (SDL_SetThreadPriority(SDL_THREAD_PRIORITY_TIME_CRITICAL) == 0)
+    state = AUDIO_RT_FALLBACK;
+  else
+    state = AUDIO_RT_FAILED;
+  atomic_store_explicit(&e->rt_state, state, memory_order_relaxed);
+}
+
 void audio_cb(void *userdata, Uint8 *stream, int len) {
   AudioEngine *e = (AudioEngine *)userdata;
   float *out = (float *)stream;
   int frames = len / (int)(sizeof(float) * e->channels);
 
-  // Debug: Log callback timing periodically
-//   if (debug_log && e->started && debug_callback_count % 20 == 0) {
-//     struct timespec now;
-//     clock_gettime(CLOCK_MONOTONIC, &now);
-//     double elapsed = (now.tv_sec - debug_start_time.tv_sec) + 
-//                      (now.tv_nsec - debug_start_time.tv_nsec) / 1e9;
-//     double since_last = (now.tv_sec - debug_last_log_time.tv_sec) + 
-//                         (now.tv_nsec - debug_last_log_time.tv_nsec) / 1e9;
-//     uint64_t cb_delta = debug_callback_count - debug_last_callback_count;
-//     double cb_rate = (since_last > 0) ? (cb_delta / since_last) : 0.0;
-    
-//     fprintf(debug_log, "CB#%lu: %.3fs real, %.3fs interval, rate=%.1f CB/s, frames_played=%lu (%.3fs audio)\n",
-//             debug_callback_count, elapsed, since_last, cb_rate, e->frames_played,
-//             (double)e->frames_played / (double)e->sample_rate);
-//     fflush(debug_log);
-    
-//     debug_last_log_time = now;
-//     debug_last_callback_count = debug_callback_count;
-//   }
-//   debug_callback_count++;
+  if (atomic_load_explicit(&e->rt_state, memory_order_relaxed) == AUDIO_RT_PENDING)
+    audio_apply_rt_priority(e);
+
+  uint64_t cb_start = mono_ns();
+  audio_stats_begin(&e->stats, cb_start, frames, e->sample_rate);
 
   if (!e->started) {
+    // Keep effects (menu ticks) audible while the song is paused
     memset(stream, 0, (size_t)len);
+    sfx_mix(&e->sfx, out, frames);
+    for (int i = 0; i < frames * 2; i++)
+      out[i] = clamp1(out[i]);
+    audio_stats_end(&e->stats, cb_start);
+    audio_sample_faults(e);
     return;
   }
 
@@ -78,17 +274,25 @@ void audio_cb(void *userdata, Uint8 *stream, int len) {
       // Always increment position to keep all stems synchronized
       s->pos++;
     }
-    out[f * 2 + 0] = clamp1(L);
-    out[f * 2 + 1] = clamp1(R);
+    out[f * 2 + 0] = L;
+    out[f * 2 + 1] = R;
     e->frames_played++;
   }
+
+  sfx_mix(&e->sfx, out, frames);
+  for (int i = 0; i < frames * 2; i++)
+    out[i] = clamp1(out[i]);
+  audio_stats_end(&e->stats, cb_start);
+  audio_sample_faults(e);
 }
 
-double audio_time_sec(const AudioEngine *e) {
+int64_t audio_time_us(const AudioEngine *e) {
+  // buffer_size is what the device actually granted, so the compensation
+  // follows runtime changes and auto-tune reopens
   int64_t compensated_frames = (int64_t)e->frames_played - (int64_t)(e->buffer_size * LATENCY_BUFFER_MULT);
   if (compensated_frames < 0)
     compensated_frames = 0;
-  return (double)compensated_frames / (double)e->sample_rate;
+  return compensated_frames * 1000000 / e->sample_rate;
 }
 
 static void stem_name_from_path(const char *path, char out[32]) {
@@ -102,42 +306,39 @@ static void stem_name_from_path(const char *path, char out[32]) {
     out[20] = '\0';
 }
 
-void load_opus_file(const char *path, Stem *stem) {
+int load_opus_file(const char *path, Stem *stem, LoadError *lerr) {
   int err = 0;
   OggOpusFile *of = op_open_file(path, &err);
   if (!of) {
-    fprintf(stderr, "opusfile: cannot open %s (err=%d)\n", path, err);
-    exit(1);
+    // opusfile reports a failed fopen() or read as EFAULT/EREAD
+    if (err == OP_EFAULT || err == OP_EREAD)
+      return load_fail(lerr, LOAD_ERR_IO, path, LOAD_NO_OFFSET, "cannot open");
+    return load_fail(lerr, LOAD_ERR_FORMAT, path, LOAD_NO_OFFSET,
+                     "not an Ogg Opus stream (opusfile err=%d)", err);
   }
 
   const OpusHead *head = op_head(of, -1);
   if (!head) {
-    fprintf(stderr, "opusfile: no head %s\n", path);
-    exit(1);
+    op_free(of);
+    return load_fail(lerr, LOAD_ERR_FORMAT, path, LOAD_NO_OFFSET, "no Opus header");
   }
 
   int in_ch = head->channel_count;
   if (in_ch <= 0 || in_ch > 8) {
-    fprintf(stderr, "opusfile: unsupported channels=%d\n", in_ch);
-    exit(1);
+    op_free(of);
+    return load_fail(lerr, LOAD_ERR_FORMAT, path, LOAD_NO_OFFSET,
+                     "unsupported channel count %d", in_ch);
   }
 
   ogg_int64_t total = op_pcm_total(of, -1);
   uint64_t total_frames_est = (total > 0) ? (uint64_t)total : 0;
 
   const int chunk = 120 * 48;
-  float *tmp = (float *)malloc((size_t)chunk * (size_t)in_ch * sizeof(float));
-  if (!tmp) {
-    perror("malloc");
-    exit(1);
-  }
-
   uint64_t cap_frames = total_frames_est ? total_frames_est : (uint64_t)48000 * 180;
+  float *tmp = (float *)malloc((size_t)chunk * (size_t)in_ch * sizeof(float));
   float *pcm = (float *)malloc((size_t)cap_frames * 2 * sizeof(float));
-  if (!pcm) {
-    perror("malloc");
-    exit(1);
-  }
+  if (!tmp || !pcm)
+    goto nomem;
   uint64_t frames = 0;
 
   while (1) {
@@ -146,8 +347,12 @@ void load_opus_file(const char *path, Stem *stem) {
     if (got == 0)
       break;
     if (got < 0) {
-      fprintf(stderr, "opusfile: decode error %d on %s\n", got, path);
-      exit(1);
+      op_free(of);
+      free(tmp);
+      free(pcm);
+      return load_fail(lerr, LOAD_ERR_FORMAT, path, LOAD_NO_OFFSET,
+                       "decode error %d after %llu frames", got,
+                       (unsigned long long)frames);
     }
 
     if (frames + (uint64_t)got > cap_frames) {
@@ -155,10 +360,8 @@ void load_opus_file(const char *path, Stem *stem) {
       while (nc < frames + (uint64_t)got)
         nc *= 2;
       float *np = (float *)realloc(pcm, (size_t)nc * 2 * sizeof(float));
-      if (!np) {
-        perror("realloc");
-        exit(1);
-      }
+      if (!np)
+        goto nomem;
       pcm = np;
       cap_frames = nc;
     }
@@ -188,55 +391,239 @@ void load_opus_file(const char *path, Stem *stem) {
   stem->target_gain = 1.0f;
   stem->enabled = 1;
   stem->is_player_track = 0;
-}
+  return 0;
 
-void audio_init(AudioEngine *e, int sample_rate) {
-  memset(e, 0, sizeof(*e));
-  e->sample_rate = sample_rate;
-  e->channels = 2;
+nomem:
+  op_free(of);
+  free(tmp);
+  free(pcm);
+  return load_fail(lerr, LOAD_ERR_NOMEM, path, LOAD_NO_OFFSET, "out of memory decoding");
+}
 
+static int audio_open_device(AudioEngine *e, int buffer_size) {
   SDL_AudioSpec want = {0}, have = {0};
   want.freq = e->sample_rate;
   want.format = AUDIO_F32SYS;
   want.channels = (Uint8)e->channels;
-  want.samples = AUDIO_BUFFER_SIZE;
+  want.samples = (Uint16)buffer_size;
   want.callback = audio_cb;
   want.userdata = e;
 
   e->dev = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
   if (!e->dev) {
     fprintf(stderr, "SDL_OpenAudioDevice: %s\n", SDL_GetError());
-    exit(1);
+    return -1;
   }
   if (have.format != want.format || have.channels != want.channels) {
     fprintf(stderr, "Audio device mismatch (need float stereo)\n");
-    exit(1);
+    SDL_CloseAudioDevice(e->dev);
+    e->dev = 0;
+    return -1;
   }
   e->sample_rate = have.freq;
   e->buffer_size = have.samples;
+  // Build the effect bank before the callback can run
+  sfx_bank_init(e->sample_rate);
+  return 0;
+}
+
+static int clamp_buffer_size(int buffer_size) {
+  if (buffer_size < AUDIO_BUFFER_MIN)
+    return AUDIO_BUFFER_MIN;
+  if (buffer_size > AUDIO_BUFFER_MAX)
+    return AUDIO_BUFFER_MAX;
+  return buffer_size;
+}
+
+static void audio_lock(AudioEngine *e) {
+  if (e->backend == AUDIO_BACKEND_SDL)
+    SDL_LockAudioDevice(e->dev);
+  else if (e->null_lock)
+    SDL_LockMutex(e->null_lock);
+}
+
+static void audio_unlock(AudioEngine *e) {
+  if (e->backend == AUDIO_BACKEND_SDL)
+    SDL_UnlockAudioDevice(e->dev);
+  else if (e->null_lock)
+    SDL_UnlockMutex(e->null_lock);
+}
+
+// Null backend: call audio_cb once per buffer period on absolute deadlines,
+// exactly as a device would, and throw the samples away.
+static int null_audio_thread(void *userdata) {
+  AudioEngine *e = (AudioEngine *)userdata;
+  float *buf = (float *)malloc((size_t)AUDIO_BUFFER_MAX * 2 * sizeof(float));
+  if (!buf)
+    return 1;
+
+  struct timespec next;
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  while (!atomic_load(&e->null_quit)) {
+    // buffer_size changes under null_lock (audio_reopen), so the period
+    // slept is always that of the buffer just rendered
+    SDL_LockMutex(e->null_lock);
+    int frames = e->buffer_size;
+    audio_cb(e, (Uint8 *)buf, frames * (int)(sizeof(float) * 2));
+    SDL_UnlockMutex(e->null_lock);
+
+    long period_ns = (long)((int64_t)frames * 1000000000ll / e->sample_rate);
+    next.tv_nsec += period_ns;
+    while (next.tv_nsec >= 1000000000l) {
+      next.tv_nsec -= 1000000000l;
+      next.tv_sec++;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+  }
+  free(buf);
+  return 0;
+}
+
+void audio_init_null(AudioEngine *e, int sample_rate, int buffer_size, AudioBackend backend) {
+  memset(e, 0, sizeof(*e));
+  e->backend = backend;
+  e->sample_rate = sample_rate;
+  e->channels = 2;
+  e->buffer_size = clamp_buffer_size(buffer_size);
+  sfx_mixer_reset(&e->sfx);
+  sfx_bank_init(e->sample_rate);
+  if (backend == AUDIO_BACKEND_NULL) {
+    e->null_lock = SDL_CreateMutex();
+    if (!e->null_lock) {
+      fprintf(stderr, "SDL_CreateMutex: %s\n", SDL_GetError());
+      exit(1);
+    }
+  }
+}
+
+void audio_init(AudioEngine *e, int sample_rate, int buffer_size, int autotune) {
+  memset(e, 0, sizeof(*e));
+  e->backend = AUDIO_BACKEND_SDL;
+  e->sample_rate = sample_rate;
+  e->channels = 2;
+  e->autotune = autotune;
+  sfx_mixer_reset(&e->sfx);
+
+  if (audio_open_device(e, clamp_buffer_size(buffer_size)) != 0) {
+    fprintf(stderr, "No usable audio device, falling back to the null backend\n");
+    audio_init_null(e, sample_rate, buffer_size, AUDIO_BACKEND_NULL);
+    return;
+  }
   // Keep audio paused until stems are loaded
   SDL_PauseAudioDevice(e->dev, 1);
 }
 
+int audio_reopen(AudioEngine *e, int buffer_size) {
+  if (e->backend != AUDIO_BACKEND_SDL) {
+    audio_lock(e);
+    e->buffer_size = clamp_buffer_size(buffer_size);
+    audio_unlock(e);
+    return e->buffer_size;
+  }
+
+  int old_size = e->buffer_size;
+  // Closing waits for an in-flight callback, so stems, positions and the
+  // SFX queue carry over untouched to the new device.
+  audio_close(e);
+  e->stats.last_cb_ns = 0;
+  e->stats.deadline_ns = 0;
+  if (audio_open_device(e, buffer_size) != 0 && audio_open_device(e, old_size) != 0)
+    return -1;
+  // New device, new callback thread
+  if (atomic_load(&e->rt_state) != AUDIO_RT_OFF)
+    atomic_store(&e->rt_state, AUDIO_RT_PENDING);
+  if (e->unpaused)
+    SDL_PauseAudioDevice(e->dev, 0);
+  return e->buffer_size;
+}
+
+void audio_close(AudioEngine *e) {
+  if (e->null_thread) {
+    atomic_store(&e->null_quit, 1);
+    SDL_WaitThread(e->null_thread, NULL);
+    e->null_thread = NULL;
+  }
+  if (e->null_lock) {
+    SDL_DestroyMutex(e->null_lock);
+    e->null_lock = NULL;
+  }
+  if (e->dev)
+    SDL_CloseAudioDevice(e->dev);
+  e->dev = 0;
+}
+
+int audio_autotune_poll(AudioEngine *e) {
+  if (!e->autotune || !e->dev)
+    return 0;
+
+  uint64_t now = mono_ns();
+  uint64_t underruns = atomic_load_explicit(&e->stats.underruns, memory_order_relaxed);
+  if (!e->autotune_window_ns) {
+    e->autotune_window_ns = now;
+    e->autotune_underruns = underruns;
+    return 0;
+  }
+
+  int next = 0;
+  if (underruns - e->autotune_underruns >= AUDIO_AUTOTUNE_UNDERRUNS) {
+    e->autotune_clean = 0;
+    if (e->buffer_size < AUDIO_BUFFER_MAX)
+      next = e->buffer_size * 2;
+  } else if (now - e->autotune_window_ns > (uint64_t)(AUDIO_AUTOTUNE_WINDOW * 1e9)) {
+    // A window without an underrun; after enough of them try a smaller size
+    if (underruns == e->autotune_underruns &&
+        ++e->autotune_clean >= AUDIO_AUTOTUNE_CLEAN_WINDOWS &&
+        e->buffer_size > AUDIO_BUFFER_MIN) {
+      e->autotune_clean = 0;
+      next = e->buffer_size / 2;
+    } else if (underruns != e->autotune_underruns) {
+      e->autotune_clean = 0;
+    }
+  } else {
+    return 0;
+  }
+
+  e->autotune_window_ns = now;
+  e->autotune_underruns = underruns;
+  if (!next)
+    return 0;
+  next = clamp_buffer_size(next);
+  if (audio_reopen(e, next) < 0) {
+    e->autotune = 0;
+    return 0;
+  }
+  e->autotune_underruns = atomic_load_explicit(&e->stats.underruns, memory_order_relaxed);
+  return e->buffer_size;
+}
+
+int audio_autotune_start(int tuned_size) {
+  return clamp_buffer_size(tuned_size / 2);
+}
+
 void audio_start(AudioEngine *e) {
-  // Initialize debug logging
-//   debug_log = fopen("/tmp/midifall_audio_debug.log", "w");
-//   if (debug_log) {
-//     clock_gettime(CLOCK_MONOTONIC, &debug_start_time);
-//     debug_last_log_time = debug_start_time;
-//     debug_callback_count = 0;
-//     debug_last_callback_count = 0;
-//     fprintf(debug_log, "Audio debug started\n");
-//     fflush(debug_log);
-//   }
-  
+  // Count from here: sample on the next callback against a fresh baseline
+  audio_lock(e);
+  atomic_store(&e->stats.minflt, 0);
+  atomic_store(&e->stats.majflt, 0);
+  e->stats.fault_thread = 0;
+  e->stats.fault_countdown = 0;
+  audio_unlock(e);
+
   e->started = 1;
-  SDL_PauseAudioDevice(e->dev, 0);
+  e->unpaused = 1;
+  if (e->backend == AUDIO_BACKEND_SDL) {
+    SDL_PauseAudioDevice(e->dev, 0);
+  } else if (e->backend == AUDIO_BACKEND_NULL && !e->null_thread) {
+    atomic_store(&e->null_quit, 0);
+    e->null_thread = SDL_CreateThread(null_audio_thread, "null-audio", e);
+    if (!e->null_thread)
+      fprintf(stderr, "SDL_CreateThread: %s\n", SDL_GetError());
+  }
 }
 
 void audio_reset(AudioEngine *e) {
   // Pause audio callback to safely reset state
-  SDL_LockAudioDevice(e->dev);
+  audio_lock(e);
   
   // Reset all stem positions and frames_played
   for (int i = 0; i < e->stem_count; i++) {
@@ -244,15 +631,237 @@ void audio_reset(AudioEngine *e) {
   }
   e->frames_played = 0;
   
-  SDL_UnlockAudioDevice(e->dev);
-  
-  // Log the reset
-//   if (debug_log) {
-//     struct timespec now;
-//     clock_gettime(CLOCK_MONOTONIC, &now);
-//     double elapsed = (now.tv_sec - debug_start_time.tv_sec) + 
-//                      (now.tv_nsec - debug_start_time.tv_nsec) / 1e9;
-//     fprintf(debug_log, "RESET at %.3fs real time\n", elapsed);
-//     fflush(debug_log);
-//   }
+  audio_unlock(e);
+}
+
+static double hist_percentile(_Atomic const uint64_t *hist, uint64_t total, double p) {
+  if (total == 0)
+    return 0.0;
+  uint64_t want = (uint64_t)((double)total * p);
+  uint64_t acc = 0;
+  for (int b = 0; b < AUDIO_HIST_BUCKETS; b++) {
+    acc += atomic_load_explicit(&hist[b], memory_order_relaxed);
+    if (acc > want)
+      return (double)(1ull << b);  // Bucket upper bound in us
+  }
+  return (double)(1ull << (AUDIO_HIST_BUCKETS - 1));
+}
+
+void audio_stats_snapshot(const AudioEngine *e, AudioStatsSnapshot *out) {
+  const AudioStats *st = &e->stats;
+  memset(out, 0, sizeof(*out));
+  out->callbacks = atomic_load_explicit(&st->callbacks, memory_order_relaxed);
+  out->late = atomic_load_explicit(&st->late, memory_order_relaxed);
+  out->underruns = atomic_load_explicit(&st->underruns, memory_order_relaxed);
+  if (e->sample_rate > 0)
+    out->period_us = (double)e->buffer_size * 1e6 / (double)e->sample_rate;
+
+  uint64_t exec_total = 0, interval_total = 0;
+  for (int b = 0; b < AUDIO_HIST_BUCKETS; b++) {
+    exec_total += atomic_load_explicit(&st->exec_hist[b], memory_order_relaxed);
+    interval_total += atomic_load_explicit(&st->interval_hist[b], memory_order_relaxed);
+  }
+  out->exec_p50_us = hist_percentile(st->exec_hist, exec_total, 0.50);
+  out->exec_p99_us = hist_percentile(st->exec_hist, exec_total, 0.99);
+  out->exec_max_us = (double)atomic_load_explicit(&st->exec_max_ns, memory_order_relaxed) / 1000.0;
+  out->interval_p50_us = hist_percentile(st->interval_hist, interval_total, 0.50);
+  out->interval_p99_us = hist_percentile(st->interval_hist, interval_total, 0.99);
+  out->interval_max_us = (double)atomic_load_explicit(&st->interval_max_ns, memory_order_relaxed) / 1000.0;
+}
+
+void audio_stats_reset(AudioEngine *e) {
+  // Lock so the callback-private fields are not reset mid-callback
+  audio_lock(e);
+  AudioStats *st = &e->stats;
+  atomic_store(&st->callbacks, 0);
+  atomic_store(&st->late, 0);
+  atomic_store(&st->underruns, 0);
+  for (int b = 0; b < AUDIO_HIST_BUCKETS; b++) {
+    atomic_store(&st->exec_hist[b], 0);
+    atomic_store(&st->interval_hist[b], 0);
+  }
+  atomic_store(&st->exec_max_ns, 0);
+  atomic_store(&st->interval_max_ns, 0);
+  st->last_cb_ns = 0;
+  st->deadline_ns = 0;
+  audio_unlock(e);
+}
+
+// Touch one byte per page so the callback never takes a first-touch fault,
+// then pin the pages so they cannot be swapped out.
+static int prefault_and_lock(void *p, size_t bytes) {
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  volatile uint8_t *b = (volatile uint8_t *)p;
+  for (size_t off = 0; off < bytes; off += page)
+    b[off] = b[off];
+  return mlock(p, bytes);
+}
+
+void audio_enable_realtime(AudioEngine *e) {
+  size_t touched = 0, locked = 0;
+  int lock_err = 0;
+
+  for (int i = 0; i < e->stem_count + SFX_COUNT; i++) {
+    void *pcm;
+    uint64_t frames;
+    if (i < e->stem_count) {
+      pcm = e->stems[i].pcm;
+      frames = e->stems[i].frames;
+    } else {
+      pcm = g_sfx_bank[i - e->stem_count].pcm;
+      frames = g_sfx_bank[i - e->stem_count].frames;
+    }
+    if (!pcm || !frames)
+      continue;
+
+    size_t bytes = (size_t)frames * 2 * sizeof(float);
+    touched += bytes;
+    if (prefault_and_lock(pcm, bytes) == 0)
+      locked += bytes;
+    else
+      lock_err = errno;
+  }
+
+  fprintf(stderr, "[audio] real-time mode: %.1f MB prefaulted, %.1f MB locked\n",
+          (double)touched / 1e6, (double)locked / 1e6);
+  if (lock_err)
+    fprintf(stderr, "[audio] mlock: %s (raise the limit with 'ulimit -l')\n",
+            strerror(lock_err));
+  atomic_store(&e->rt_state, AUDIO_RT_PENDING);
+}
+
+void audio_page_faults(const AudioEngine *e, long *minor, long *major) {
+  *minor = (long)atomic_load_explicit(&e->stats.minflt, memory_order_relaxed);
+  *major = (long)atomic_load_explicit(&e->stats.majflt, memory_order_relaxed);
+}
+
+const char *audio_rt_describe(const AudioEngine *e) {
+  switch (atomic_load(&e->rt_state)) {
+  case AUDIO_RT_PENDING:
+    return "pending";
+  case AUDIO_RT_FIFO:
+    return "SCHED_FIFO";
+  case AUDIO_RT_FALLBACK:
+    return "SDL time-critical";
+  case AUDIO_RT_FAILED:
+    return "failed (normal priority)";
+  default:
+    return "off";
+  }
+}
+
+void audio_render(AudioEngine *e, float *out, int frames) {
+  audio_cb(e, (Uint8 *)out, frames * (int)(sizeof(float) * 2));
+}
+
+static void put_le16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_le32(uint8_t *p, uint32_t v) {
+  put_le16(p, (uint16_t)v);
+  put_le16(p + 2, (uint16_t)(v >> 16));
+}
+
+static void wav_header(uint8_t h[44], int sample_rate, uint64_t frames) {
+  uint32_t data_bytes = (uint32_t)(frames * 4);  // 2 channels * 16 bit
+  memcpy(h, "RIFF", 4);
+  put_le32(h + 4, 36 + data_bytes);
+  memcpy(h + 8, "WAVEfmt ", 8);
+  put_le32(h + 16, 16);  // PCM fmt chunk size
+  put_le16(h + 20, 1);   // PCM
+  put_le16(h + 22, 2);
+  put_le32(h + 24, (uint32_t)sample_rate);
+  put_le32(h + 28, (uint32_t)sample_rate * 4);
+  put_le16(h + 32, 4);
+  put_le16(h + 34, 16);
+  memcpy(h + 36, "data", 4);
+  put_le32(h + 40, data_bytes);
+}
+
+int audio_mixdown(AudioEngine *e, const char *wav_path, MixdownResult *out) {
+  if (e->backend != AUDIO_BACKEND_OFFLINE) {
+    fprintf(stderr, "audio_mixdown needs the offline backend\n");
+    return -1;
+  }
+
+  uint64_t total = 0;
+  for (int i = 0; i < e->stem_count; i++)
+    if (e->stems[i].frames > total)
+      total = e->stems[i].frames;
+
+  // Every write is checked: a short WAV would throw off A/V sync checks
+  // without anyone noticing, so a failed one removes the file
+  FILE *wav = NULL;
+  uint8_t header[44];
+  int ok = 1;
+  if (wav_path) {
+    wav = fopen(wav_path, "wb");
+    if (!wav) {
+      perror(wav_path);
+      return -1;
+    }
+    wav_header(header, e->sample_rate, 0);  // Sizes patched at the end
+    ok &= fwrite(header, 1, sizeof(header), wav) == sizeof(header);
+  }
+
+  int chunk = e->buffer_size;
+  float *buf = (float *)malloc((size_t)chunk * 2 * sizeof(float));
+  int16_t *pcm16 = (int16_t *)malloc((size_t)chunk * 2 * sizeof(int16_t));
+  if (!buf || !pcm16) {
+    perror("malloc");
+    free(buf);
+    free(pcm16);
+    if (wav) {
+      fclose(wav);
+      unlink(wav_path);
+    }
+    return -1;
+  }
+
+  audio_reset(e);
+  e->started = 1;
+  uint64_t t0 = mono_ns();
+  uint64_t done = 0;
+  while (done < total && ok) {
+    int n = (total - done < (uint64_t)chunk) ? (int)(total - done) : chunk;
+    audio_render(e, buf, n);
+    if (wav) {
+      for (int i = 0; i < n * 2; i++)
+        pcm16[i] = (int16_t)lrintf(buf[i] * 32767.0f);
+      // Little-endian hosts
+      ok &= fwrite(pcm16, sizeof(int16_t), (size_t)n * 2, wav) == (size_t)n * 2;
+    }
+    done += (uint64_t)n;
+  }
+  uint64_t t1 = mono_ns();
+  e->started = 0;
+
+  free(buf);
+  free(pcm16);
+  if (wav) {
+    wav_header(header, e->sample_rate, done);
+    ok = ok && fseek(wav, 0, SEEK_SET) == 0 &&
+         fwrite(header, 1, sizeof(header), wav) == sizeof(header);
+    if (!ok)
+      perror(wav_path);
+    if (fclose(wav) != 0 && ok) {
+      perror(wav_path);
+      ok = 0;
+    }
+    if (!ok) {
+      unlink(wav_path);
+      return -1;
+    }
+  }
+
+  if (out) {
+    out->frames = done;
+    out->elapsed_sec = (double)(t1 - t0) / 1e9;
+    out->realtime_factor = out->elapsed_sec > 0.0
+                               ? ((double)done / (double)e->sample_rate) / out->elapsed_sec
+                               : 0.0;
+  }
+  return 0;
 }
@@ -1,7 +1,10 @@
 #ifndef AUDIO_H
 #define AUDIO_H
 
+#include "config.h"
+#include "loaderr.h"
 #include <SDL2/SDL.h>
+#include <stdatomic.h>
 #include <stdint.h>
 
 typedef struct {
@@ -15,22 +18,154 @@ typedef struct {
   int is_player_track;  // Flag for guitar/player track
 } Stem;
 
+typedef enum {
+  SFX_MISS,        // Clunk on a wrong strum or a broken streak
+  SFX_STAR_POWER,  // Max multiplier reached
+  SFX_MENU_TICK,   // Menu navigation
+  SFX_COUNT
+} SfxId;
+
+typedef struct {
+  uint8_t id;
+  float gain;
+} SfxTrigger;
+
+typedef struct {
+  int id;  // -1 when the voice is free
+  uint64_t pos;
+  float gain;
+} SfxVoice;
+
+// Single-producer (game thread) / single-consumer (audio callback) queue
+// feeding a fixed voice pool. Nothing here allocates or locks.
+typedef struct {
+  SfxTrigger queue[SFX_QUEUE_SIZE];
+  _Atomic uint32_t head;  // Written by the game thread only
+  _Atomic uint32_t tail;  // Written by the audio callback only
+  SfxVoice voices[SFX_MAX_VOICES];
+} SfxMixer;
+
+// Written by the audio callback, read from the game thread. Counters are
+// relaxed atomics; readers only need eventually-consistent totals.
+typedef struct {
+  _Atomic uint64_t callbacks;
+  _Atomic uint64_t late;       // Callback started after its deadline
+  _Atomic uint64_t underruns;  // More than a full buffer late: device ran dry
+  _Atomic uint64_t exec_hist[AUDIO_HIST_BUCKETS];
+  _Atomic uint64_t interval_hist[AUDIO_HIST_BUCKETS];
+  _Atomic uint64_t exec_max_ns;
+  _Atomic uint64_t interval_max_ns;
+  _Atomic uint64_t minflt, majflt;  // Callback thread page faults while started
+  uint64_t last_cb_ns;   // Callback-private
+  uint64_t deadline_ns;  // Callback-private
+  // Callback-private: the thread's fault counters at the last sample. A new
+  // device brings a new thread, which only sets a new baseline.
+  SDL_threadID fault_thread;
+  long fault_min_seen, fault_maj_seen;
+  uint32_t fault_countdown;
+} AudioStats;
+
+typedef struct {
+  uint64_t callbacks;
+  uint64_t late;
+  uint64_t underruns;
+  double period_us;  // Nominal time between callbacks
+  double exec_p50_us, exec_p99_us, exec_max_us;
+  double interval_p50_us, interval_p99_us, interval_max_us;
+} AudioStatsSnapshot;
+
+typedef enum {
+  AUDIO_RT_OFF,       // Real-time mode not requested
+  AUDIO_RT_PENDING,   // Applied on the next callback
+  AUDIO_RT_FIFO,      // Callback thread runs at SCHED_FIFO
+  AUDIO_RT_FALLBACK,  // SCHED_FIFO refused; SDL time-critical priority instead
+  AUDIO_RT_FAILED     // No priority change possible
+} AudioRtState;
+
+typedef enum {
+  AUDIO_BACKEND_SDL,   // Real device, SDL drives audio_cb
+  AUDIO_BACKEND_NULL,  // No device; a thread paces audio_cb in real time
+  AUDIO_BACKEND_OFFLINE  // No device, no thread; caller pumps audio_render
+} AudioBackend;
+
 typedef struct {
   Stem *stems;
   int stem_count;
+  AudioBackend backend;
   int sample_rate;
   int channels;
   SDL_AudioDeviceID dev;
   uint64_t frames_played;
-  int buffer_size;
+  int buffer_size;  // Actual frames per callback granted by the device
   int started;
+  int unpaused;  // Device running (audio_start called)
+  int autotune;  // Resize buffer_size to the lowest size that does not underrun
+  uint64_t autotune_window_ns;
+  uint64_t autotune_underruns;  // Underrun count at window start
+  int autotune_clean;  // Windows in a row without an underrun
+  SDL_Thread *null_thread;  // AUDIO_BACKEND_NULL pacing thread
+  SDL_mutex *null_lock;     // Stands in for SDL_LockAudioDevice
+  _Atomic int null_quit;
+  _Atomic int rt_state;  // AudioRtState
+  SfxMixer sfx;
+  AudioStats stats;
 } AudioEngine;
 
-double audio_time_sec(const AudioEngine *e);
+// Song position in microseconds, from the played sample count minus the
+// device latency
+int64_t audio_time_us(const AudioEngine *e);
 void audio_cb(void *userdata, Uint8 *stream, int len);
-void load_opus_file(const char *path, Stem *stem);
-void audio_init(AudioEngine *e, int sample_rate);
+// Decodes a whole Ogg Opus file to stereo float. Returns -1 with *err (may
+// be NULL) filled in if the file cannot be read or decoded; *stem is untouched.
+int load_opus_file(const char *path, Stem *stem, LoadError *err);
+// Opens the default SDL device; falls back to the null backend when no
+// float-stereo device is available.
+void audio_init(AudioEngine *e, int sample_rate, int buffer_size, int autotune);
+// Device-less engine (AUDIO_BACKEND_NULL or AUDIO_BACKEND_OFFLINE)
+void audio_init_null(AudioEngine *e, int sample_rate, int buffer_size, AudioBackend backend);
+int audio_reopen(AudioEngine *e, int buffer_size);
+void audio_close(AudioEngine *e);
 void audio_start(AudioEngine *e);
 void audio_reset(AudioEngine *e);
 
+// Opt-in real-time mode: prefault and mlock every stem and the SFX bank,
+// and raise the callback thread to SCHED_FIFO on its next run. Failures
+// are reported and degrade to normal scheduling / unlocked memory.
+// Call after the stems are loaded.
+void audio_enable_realtime(AudioEngine *e);
+
+// Page faults taken on the audio callback thread since audio_start,
+// sampled every AUDIO_FAULT_SAMPLE_CALLBACKS callbacks
+void audio_page_faults(const AudioEngine *e, long *minor, long *major);
+const char *audio_rt_describe(const AudioEngine *e);
+
+// Run the mixer for frames frames into out (interleaved stereo), as fast as
+// the CPU allows. Only valid for AUDIO_BACKEND_OFFLINE.
+void audio_render(AudioEngine *e, float *out, int frames);
+
+typedef struct {
+  uint64_t frames;  // Frames mixed
+  double elapsed_sec;  // Wall-clock time spent mixing
+  double realtime_factor;  // Audio seconds mixed per wall-clock second
+} MixdownResult;
+
+// Mix every stem from the start until the longest one ends, optionally
+// writing a 16-bit stereo WAV (wav_path may be NULL). Returns 0 on success.
+int audio_mixdown(AudioEngine *e, const char *wav_path, MixdownResult *out);
+
+// Call once per frame; returns the new buffer size when auto-tune changed
+// it, 0 otherwise.
+int audio_autotune_poll(AudioEngine *e);
+// Size for auto-tune to open the device with: one step below the saved one,
+// so a single busy session does not raise the latency for good
+int audio_autotune_start(int tuned_size);
+
+// Queue a one-shot effect; safe to call from the game thread at any time.
+// Triggers are dropped if the queue is full.
+void audio_sfx_play(AudioEngine *e, SfxId id, float gain);
+
+// Callback timing statistics (percentiles are histogram bucket upper bounds)
+void audio_stats_snapshot(const AudioEngine *e, AudioStatsSnapshot *out);
+void audio_stats_reset(AudioEngine *e);
+
 #endif
@@ -3,10 +3,15 @@
 
 #include "chart.h"
 #include "midi.h"
-#include <ctype.h>
+#include "tempo.h"
+#include "loaderr.h"
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 // .chart format parser for Clone Hero / Phase Shift
 // Format documentation:
@@ -24,220 +29,318 @@
 // - Lanes: 0=green, 1=red, 2=yellow, 3=blue, 4=orange
 // - Resolution: ticks per quarter note (e.g., 192)
 
+// Note modifiers from N 5 / N 6 markers
+enum { CHART_FORCED = 1 << 0, CHART_TAP = 1 << 1 };
+
+// Temporary storage for chart notes (tick-based)
 typedef struct {
   int tick;
-  int uspqn;  // Microseconds per quarter note
-} TempoBPM;
+  int lane;
+  int duration;
+  int diff;
+  uint8_t flags;  // CHART_FORCED | CHART_TAP
+} ChartNote;
 
+// A modifier marker, resolved against the notes at its tick when the
+// difficulty section ends
 typedef struct {
-  TempoBPM *v;
-  size_t n;
-  size_t cap;
-} TempoBPMVec;
+  int tick;
+  uint8_t flags;
+} ChartMark;
 
-static void tempo_bpm_vec_push(TempoBPMVec *vec, int tick, int uspqn) {
-  if (vec->n >= vec->cap) {
-    vec->cap = vec->cap ? vec->cap * 2 : 64;
-    vec->v = (TempoBPM *)realloc(vec->v, vec->cap * sizeof(TempoBPM));
-  }
-  vec->v[vec->n].tick = tick;
-  vec->v[vec->n].uspqn = uspqn;
-  vec->n++;
+static int cmp_chart_note(const void *A, const void *B) {
+  const ChartNote *a = (const ChartNote *)A;
+  const ChartNote *b = (const ChartNote *)B;
+  return (a->tick > b->tick) - (a->tick < b->tick);
 }
 
-// Convert tick to seconds using tempo map
-static double tick_to_sec(int tick, int resolution, const TempoBPMVec *tempos) {
-  if (tempos->n == 0) {
-    // Default 120 BPM (500000 microseconds per quarter note)
-    return (double)tick / (double)resolution * 0.5;
+static int cmp_chart_mark(const void *A, const void *B) {
+  const ChartMark *a = (const ChartMark *)A;
+  const ChartMark *b = (const ChartMark *)B;
+  return (a->tick > b->tick) - (a->tick < b->tick);
+}
+
+// Merge-walk one section's notes and markers, both in tick order (sorted
+// first if a hand-edited file is not), so marking stays linear.
+static void apply_marks(ChartNote *notes, size_t n, ChartMark *marks, size_t m) {
+  if (m == 0)
+    return;
+  for (size_t i = 1; i < n; i++) {
+    if (notes[i].tick < notes[i - 1].tick) {
+      qsort(notes, n, sizeof(ChartNote), cmp_chart_note);
+      break;
+    }
   }
-  
-  double sec = 0.0;
-  int current_tick = 0;
-  int current_uspqn = tempos->v[0].uspqn;
-  
-  for (size_t i = 0; i < tempos->n; i++) {
-    if (tempos->v[i].tick > tick) {
-      // Add time from current_tick to target tick
-      int delta_ticks = tick - current_tick;
-      double sec_per_tick = (double)current_uspqn / 1000000.0 / (double)resolution;
-      sec += (double)delta_ticks * sec_per_tick;
-      return sec;
+  for (size_t i = 1; i < m; i++) {
+    if (marks[i].tick < marks[i - 1].tick) {
+      qsort(marks, m, sizeof(ChartMark), cmp_chart_mark);
+      break;
     }
-    
-    // Add time from current_tick to this tempo change
-    int delta_ticks = tempos->v[i].tick - current_tick;
-    double sec_per_tick = (double)current_uspqn / 1000000.0 / (double)resolution;
-    sec += (double)delta_ticks * sec_per_tick;
-    
-    current_tick = tempos->v[i].tick;
-    current_uspqn = tempos->v[i].uspqn;
   }
-  
-  // Add remaining time after last tempo change
-  int delta_ticks = tick - current_tick;
-  double sec_per_tick = (double)current_uspqn / 1000000.0 / (double)resolution;
-  sec += (double)delta_ticks * sec_per_tick;
-  
-  return sec;
+  size_t k = 0;
+  for (size_t i = 0; i < n; i++) {
+    while (k < m && marks[k].tick < notes[i].tick)
+      k++;
+    for (size_t j = k; j < m && marks[j].tick == notes[i].tick; j++)
+      notes[i].flags |= marks[j].flags;
+  }
 }
 
-// Trim leading/trailing whitespace
-static char *trim(char *str) {
-  char *end;
-  
-  // Trim leading space
-  while (isspace((unsigned char)*str)) str++;
-  
-  if (*str == 0) return str;
-  
-  // Trim trailing space
-  end = str + strlen(str) - 1;
-  while (end > str && isspace((unsigned char)*end)) end--;
-  
-  end[1] = '\0';
-  return str;
+// Sections are resolved once at their header. Difficulty sections map
+// straight to the diff index; everything else is skipped line by line.
+typedef enum {
+  SEC_OTHER = -1,
+  SEC_EASY = 0,
+  SEC_MEDIUM,
+  SEC_HARD,
+  SEC_EXPERT,
+  SEC_SONG,
+  SEC_SYNC_TRACK,
+} ChartSection;
+
+static const struct {
+  const char *name;
+  ChartSection sec;
+} g_sections[] = {
+    {"Song", SEC_SONG},           {"SyncTrack", SEC_SYNC_TRACK},
+    {"ExpertSingle", SEC_EXPERT}, {"HardSingle", SEC_HARD},
+    {"MediumSingle", SEC_MEDIUM}, {"EasySingle", SEC_EASY},
+};
+
+static ChartSection chart_section(const char *s, size_t len) {
+  for (size_t i = 0; i < sizeof(g_sections) / sizeof(g_sections[0]); i++)
+    if (strlen(g_sections[i].name) == len && memcmp(s, g_sections[i].name, len) == 0)
+      return g_sections[i].sec;
+  return SEC_OTHER;
+}
+
+// The tokenizer works on the mapped file, which is not NUL-terminated:
+// every helper takes an explicit end and never reads past it.
+static inline int is_blank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+static const char *skip_blank(const char *p, const char *end) {
+  while (p < end && is_blank(*p)) p++;
+  return p;
+}
+
+// Parses a decimal integer at *p (leading blanks allowed) and advances past
+// it. Returns 0 if there are no digits. Saturates instead of overflowing.
+static int parse_int(const char **p, const char *end, int *out) {
+  const char *s = skip_blank(*p, end);
+  int neg = (s < end && (*s == '-' || *s == '+')) ? (*s++ == '-') : 0;
+  const char *digits = s;
+  int64_t v = 0;
+  for (; s < end && *s >= '0' && *s <= '9'; s++)
+    if (v < INT32_MAX)
+      v = v * 10 + (*s - '0');
+  if (s == digits)
+    return 0;
+  if (v > INT32_MAX) v = INT32_MAX;
+  *out = (int)(neg ? -v : v);
+  *p = s;
+  return 1;
+}
+
+// Plain "[-]int[.frac]" as used by Offset; no exponent forms
+static double parse_decimal(const char *s, const char *end) {
+  s = skip_blank(s, end);
+  int neg = (s < end && (*s == '-' || *s == '+')) ? (*s++ == '-') : 0;
+  double v = 0.0;
+  for (; s < end && *s >= '0' && *s <= '9'; s++)
+    v = v * 10.0 + (*s - '0');
+  if (s < end && *s == '.') {
+    double scale = 0.1;
+    for (s++; s < end && *s >= '0' && *s <= '9'; s++, scale *= 0.1)
+      v += (*s - '0') * scale;
+  }
+  return neg ? -v : v;
 }
 
-int chart_parse(const char *path, NoteVec *notes, TrackNameVec *track_names) {
-  FILE *f = fopen(path, "r");
-  if (!f) {
-    fprintf(stderr, "Failed to open chart file: %s\n", path);
+static int key_is(const char *s, const char *end, const char *key) {
+  size_t len = strlen(key);
+  return (size_t)(end - s) == len && memcmp(s, key, len) == 0;
+}
+
+int chart_parse(const char *path, NoteVec *notes, TrackNameVec *track_names,
+                LoadError *err) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return load_fail(err, LOAD_ERR_IO, path, LOAD_NO_OFFSET, "cannot open");
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    load_fail(err, LOAD_ERR_IO, path, LOAD_NO_OFFSET, "cannot stat");
+    close(fd);
     return -1;
   }
-  
-  char line[512];
-  char section[64] = "";
+  // Tokenized in place from the page cache: no line buffer, no copies
+  size_t sz = (size_t)st.st_size;
+  const char *buf = NULL;
+  if (sz > 0) {
+    void *map = mmap(NULL, sz, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+      load_fail(err, LOAD_ERR_IO, path, LOAD_NO_OFFSET, "cannot map");
+      close(fd);
+      return -1;
+    }
+    madvise(map, sz, MADV_SEQUENTIAL);
+    buf = (const char *)map;
+  }
+  close(fd);
+
+  ChartSection section = SEC_OTHER;
   int resolution = 192;  // Default resolution
   double chart_offset = 0.0;  // Offset in seconds from [Song] section
-  TempoBPMVec tempos = {0};
-  
-  // Temporary storage for chart notes (tick-based)
-  typedef struct {
-    int tick;
-    int lane;
-    int duration;
-    int diff;
-    int is_forced;  // N 5 0 = forced strum
-  } ChartNote;
+  TempoMap tempos;
+  tempo_map_init(&tempos, resolution);
   
   ChartNote *chart_notes = NULL;
   size_t chart_note_count = 0;
   size_t chart_note_cap = 0;
+
+  // Markers of the current difficulty section, and where its notes start
+  ChartMark *marks = NULL;
+  size_t mark_count = 0;
+  size_t mark_cap = 0;
+  size_t section_first_note = 0;
+
+  const char *p = buf;
+  const char *end = buf + sz;
+  if (sz >= 3 && memcmp(p, "\xEF\xBB\xBF", 3) == 0)
+    p += 3;  // UTF-8 BOM written by some editors
   
-  while (fgets(line, sizeof(line), f)) {
-    char *trimmed = trim(line);
+  while (p < end) {
+    // One line, blanks trimmed on both sides; lines of any length are
+    // handled whole
+    const char *eol = (const char *)memchr(p, '\n', (size_t)(end - p));
+    if (!eol) eol = end;
+    const char *s = skip_blank(p, eol);
+    const char *e = eol;
+    while (e > s && is_blank(e[-1])) e--;
+    p = (eol < end) ? eol + 1 : end;
     
     // Skip empty lines and comments
-    if (trimmed[0] == '\0' || trimmed[0] == '#') continue;
+    if (s == e || *s == '#') continue;
     
     // Section header
-    if (trimmed[0] == '[') {
-      char *end = strchr(trimmed, ']');
-      if (end) {
-        *end = '\0';
-        strncpy(section, trimmed + 1, sizeof(section) - 1);
-        section[sizeof(section) - 1] = '\0';
-      }
+    if (*s == '[') {
+      apply_marks(chart_notes + section_first_note,
+                  chart_note_count - section_first_note, marks, mark_count);
+      section_first_note = chart_note_count;
+      mark_count = 0;
+      const char *close_br = (const char *)memchr(s, ']', (size_t)(e - s));
+      if (close_br)
+        section = chart_section(s + 1, (size_t)(close_br - s - 1));
       continue;
     }
     
-    // Skip opening/closing braces
-    if (strcmp(trimmed, "{") == 0 || strcmp(trimmed, "}") == 0) continue;
+    // Braces, events, other instruments
+    if (section == SEC_OTHER) continue;
     
     // Parse key = value pairs
-    char *eq = strchr(trimmed, '=');
+    const char *eq = (const char *)memchr(s, '=', (size_t)(e - s));
     if (!eq) continue;
-    
-    *eq = '\0';
-    char *key = trim(trimmed);
-    char *value = trim(eq + 1);
+    const char *key_end = eq;
+    while (key_end > s && is_blank(key_end[-1])) key_end--;
+    const char *value = skip_blank(eq + 1, e);
+    if (value == e) continue;
     
     // Parse [Song] section
-    if (strcmp(section, "Song") == 0) {
-      if (strcmp(key, "Resolution") == 0) {
-        resolution = atoi(value);
-        if (resolution <= 0) resolution = 192;
-      } else if (strcmp(key, "Offset") == 0) {
+    if (section == SEC_SONG) {
+      if (key_is(s, key_end, "Resolution")) {
+        if (!parse_int(&value, e, &resolution) || resolution <= 0)
+          resolution = 192;
+      } else if (key_is(s, key_end, "Offset")) {
         // Offset is in seconds
-        chart_offset = atof(value);
+        chart_offset = parse_decimal(value, e);
       }
+      continue;
     }
+
+    int tick;
+    if (!parse_int(&s, key_end, &tick) || tick < 0) continue;
+
     // Parse [SyncTrack] section
-    else if (strcmp(section, "SyncTrack") == 0) {
-      int tick = atoi(key);
-      
+    if (section == SEC_SYNC_TRACK) {
       // Parse tempo changes (B = BPM * 1000)
       // Example: "0 = B 117000" means 117 BPM
-      if (value[0] == 'B') {
-        int bpm_value = atoi(value + 2);
+      int bpm_value;
+      if (*value++ == 'B' && parse_int(&value, e, &bpm_value) && bpm_value > 0) {
         // Convert BPM to microseconds per quarter note
         // Formula: uspqn = 60,000,000 / BPM
         double bpm = (double)bpm_value / 1000.0;
-        int uspqn = (int)(60000000.0 / bpm);
-        tempo_bpm_vec_push(&tempos, tick, uspqn);
+        uint32_t uspqn = (uint32_t)(60000000.0 / bpm);
+        if (tempo_map_add(&tempos, (uint64_t)tick, uspqn) != 0)
+          goto nomem;
       }
       // We can ignore TS (time signature) for now
+      continue;
     }
-    // Parse guitar difficulty sections
-    else if (strcmp(section, "ExpertSingle") == 0 ||
-             strcmp(section, "HardSingle") == 0 ||
-             strcmp(section, "MediumSingle") == 0 ||
-             strcmp(section, "EasySingle") == 0) {
-      
-      int diff = 0;
-      if (strcmp(section, "ExpertSingle") == 0) diff = 3;
-      else if (strcmp(section, "HardSingle") == 0) diff = 2;
-      else if (strcmp(section, "MediumSingle") == 0) diff = 1;
-      else if (strcmp(section, "EasySingle") == 0) diff = 0;
-      
-      int tick = atoi(key);
-      
-      // Parse note format: "N lane duration"
-      if (value[0] == 'N') {
-        int lane = -1;
-        int duration = 0;
-        
-        if (sscanf(value, "N %d %d", &lane, &duration) == 2) {
-          // Lane 5 = forced strum (not a note)
-          // Lane 6 = tap note marker (not a note)
-          // Lanes 0-4 = actual notes
-          if (lane >= 0 && lane <= 4) {
-            // Add to chart notes
-            if (chart_note_count >= chart_note_cap) {
-              chart_note_cap = chart_note_cap ? chart_note_cap * 2 : 2048;
-              chart_notes = (ChartNote *)realloc(chart_notes, chart_note_cap * sizeof(ChartNote));
-            }
-            
-            chart_notes[chart_note_count].tick = tick;
-            chart_notes[chart_note_count].lane = lane;
-            chart_notes[chart_note_count].duration = duration;
-            chart_notes[chart_note_count].diff = diff;
-            chart_notes[chart_note_count].is_forced = 0;
-            chart_note_count++;
-          } else if (lane == 5 && duration == 0) {
-            // Mark the note at this tick as forced strum
-            for (size_t i = 0; i < chart_note_count; i++) {
-              if (chart_notes[i].tick == tick && chart_notes[i].diff == diff) {
-                chart_notes[i].is_forced = 1;
-              }
-            }
-          }
-        }
+
+    // Guitar difficulty section; note format: "N lane duration"
+    // We can ignore S (star power) and E (events) for now
+    int lane, duration;
+    if (*value++ != 'N' || !parse_int(&value, e, &lane) ||
+        !parse_int(&value, e, &duration))
+      continue;
+
+    // Lane 5 = forced strum (not a note)
+    // Lane 6 = tap note marker (not a note)
+    // Lanes 0-4 = actual notes
+    if (lane >= 0 && lane <= 4) {
+      // Add to chart notes
+      if (chart_note_count >= chart_note_cap) {
+        size_t nc = chart_note_cap ? chart_note_cap * 2 : 2048;
+        ChartNote *nv = (ChartNote *)realloc(chart_notes, nc * sizeof(ChartNote));
+        if (!nv) goto nomem;
+        chart_notes = nv;
+        chart_note_cap = nc;
       }
-      // We can ignore S (star power) and E (events) for now
+
+      chart_notes[chart_note_count].tick = tick;
+      chart_notes[chart_note_count].lane = lane;
+      chart_notes[chart_note_count].duration = duration;
+      chart_notes[chart_note_count].diff = (int)section;
+      chart_notes[chart_note_count].flags = 0;
+      chart_note_count++;
+    } else if (lane == 5 || lane == 6) {
+      // Forced strum / tap marker for the notes at this tick
+      if (mark_count >= mark_cap) {
+        size_t nc = mark_cap ? mark_cap * 2 : 256;
+        ChartMark *nv = (ChartMark *)realloc(marks, nc * sizeof(ChartMark));
+        if (!nv) goto nomem;
+        marks = nv;
+        mark_cap = nc;
+      }
+      marks[mark_count].tick = tick;
+      marks[mark_count].flags = (lane == 5) ? CHART_FORCED : CHART_TAP;
+      mark_count++;
     }
   }
   
-  fclose(f);
+  if (buf)
+    munmap((void *)buf, sz);
+  buf = NULL;
+  apply_marks(chart_notes + section_first_note,
+              chart_note_count - section_first_note, marks, mark_count);
+  free(marks);
+  marks = NULL;
   
+  // [Song] may come after [SyncTrack]; the resolution is only final now
+  tempos.resolution = resolution;
+  if (tempo_map_finish(&tempos) != 0)
+    goto nomem;
+
+  // Each difficulty section is in tick order, so the start cursor walks
+  // forward; sustain ends overlap and go through the binary search
+  TempoCursor tc = tempo_cursor(&tempos);
+
   // Convert chart notes to NoteOn format
   for (size_t i = 0; i < chart_note_count; i++) {
-    double t_sec = tick_to_sec(chart_notes[i].tick, resolution, &tempos);
+    double t_sec = tempo_cursor_sec(&tc, (uint64_t)chart_notes[i].tick);
     
     // Calculate duration in seconds
     int end_tick = chart_notes[i].tick + chart_notes[i].duration;
-    double end_sec = tick_to_sec(end_tick, resolution, &tempos);
+    double end_sec = tempo_tick_to_sec(&tempos, (uint64_t)end_tick);
     double duration_sec = end_sec - t_sec;
     
     // Apply chart offset
@@ -254,11 +357,15 @@ int chart_parse(const char *path, NoteVec *notes, TrackNameVec *track_names) {
     note.pitch = pitch;
     note.lane = chart_notes[i].lane;
     note.diff = chart_notes[i].diff;
-    note.vel = chart_notes[i].is_forced ? 96 : 100;  // Use velocity to mark forced notes
+    // Velocity below 100 marks a HOPO in build_chords: forced notes flip to
+    // HOPO as before, and tap notes play without a strum the same way
+    note.vel = chart_notes[i].flags ? 96 : 100;
     note.track = 0;  // All chart notes are on track 0
+    note.dur_ticks = (uint32_t)chart_notes[i].duration;
     note.duration_sec = duration_sec;
     
-    nv_push(notes, note);
+    if (nv_push(notes, note) != 0)
+      goto nomem;
   }
   
   // Add a track name for the guitar part
@@ -267,12 +374,13 @@ int chart_parse(const char *path, NoteVec *notes, TrackNameVec *track_names) {
     tn.track_num = 0;
     strncpy(tn.name, "PART GUITAR", sizeof(tn.name) - 1);
     tn.name[sizeof(tn.name) - 1] = '\0';
-    tnv_push(track_names, tn);
+    if (tnv_push(track_names, tn) != 0)
+      goto nomem;
   }
   
   // Cleanup
   free(chart_notes);
-  free(tempos.v);
+  tempo_map_free(&tempos);
   
   fprintf(stderr, "Parsed %zu notes from .chart file (resolution=%d, offset=%.3fs)\n", 
           notes->n, resolution, chart_offset);
@@ -288,4 +396,12 @@ int chart_parse(const char *path, NoteVec *notes, TrackNameVec *track_names) {
   }
   
   return 0;
+
+nomem:
+  if (buf)
+    munmap((void *)buf, sz);
+  free(marks);
+  free(chart_notes);
+  tempo_map_free(&tempos);
+  return load_fail(err, LOAD_ERR_NOMEM, path, LOAD_NO_OFFSET, "out of memory");
 }
@@ -5,7 +5,8 @@
 #include <stdint.h>
 
 // Parse .chart file and populate note vector
-// Returns 0 on success, -1 on error
-int chart_parse(const char *path, NoteVec *notes, TrackNameVec *track_names);
+// Returns 0 on success, -1 on error with *err (may be NULL) filled in
+int chart_parse(const char *path, NoteVec *notes, TrackNameVec *track_names,
+                LoadError *err);
 
 #endif
@@ -0,0 +1,352 @@
+#define _DEFAULT_SOURCE
+#define _POSIX_C_SOURCE 200809L
+
+#include "chartcache.h"
+#include "chart.h"
+#include "config.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// .ghc layout: GhcHeader, then the NoteOns, the TrackNames, one uint64_t
+// chord count per table and the chord tables back to back, each as its
+// t_us, end_us, max_end_us, mask and is_hopo columns. Structs are stored raw; their
+// sizes are in the header so a layout change rebuilds.
+#define GHC_MAGIC 0x31434847u  // "GHC1"
+
+// Bytes per chord over all ChordVec columns
+#define GHC_CHORD_SIZE (3 * sizeof(int64_t) + 2 * sizeof(uint8_t))
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t note_size;
+  uint32_t track_name_size;
+  uint32_t chord_size;  // GHC_CHORD_SIZE
+  int32_t hopo_ticks;
+  int32_t max_track;
+  uint32_t reserved;
+  // Source chart the file was compiled from
+  uint64_t src_size;
+  int64_t src_mtime_ns;
+  uint64_t src_hash;
+  uint64_t note_count;
+  uint64_t track_name_count;
+  uint64_t chord_count;  // Sum over all tables
+  uint64_t payload_hash;  // Everything after the header, piece by piece
+} GhcHeader;
+
+static const ChordVec g_no_chords;
+
+// FNV-1a over 64-bit words with a final fold; seeded so separate buffers
+// chain into one hash
+static uint64_t hash_bytes(const void *data, size_t n, uint64_t h) {
+  const uint8_t *b = (const uint8_t *)data;
+  for (; n >= 8; b += 8, n -= 8) {
+    uint64_t w;
+    memcpy(&w, b, 8);
+    h = (h ^ w) * 0x100000001b3ull;
+    h ^= h >> 29;
+  }
+  for (; n > 0; b++, n--)
+    h = (h ^ *b) * 0x100000001b3ull;
+  return h;
+}
+#define HASH_SEED 0xcbf29ce484222325ull
+
+static int64_t mtime_ns(const struct stat *st) {
+  return (int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+}
+
+// Maps a whole file read-only. Returns NULL (and leaves *size 0) if it
+// cannot be opened, with errno set, or is empty, with errno 0.
+static const uint8_t *map_file(const char *path, size_t *size, struct stat *st) {
+  *size = 0;
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return NULL;
+  int e = fstat(fd, st) != 0 ? errno : 0;
+  if (e || st->st_size <= 0) {
+    close(fd);
+    errno = e;
+    return NULL;
+  }
+  void *map = mmap(NULL, (size_t)st->st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return NULL;
+  *size = (size_t)st->st_size;
+  return (const uint8_t *)map;
+}
+
+// $XDG_CACHE_HOME/midifall/<hash of the source path>.ghc, creating the
+// directories on the way. Returns 0 if there is nowhere to put it.
+static int cache_path(const char *notes_path, char *out, size_t size) {
+  char dir[4096];
+  const char *xdg = getenv("XDG_CACHE_HOME");
+  const char *home = getenv("HOME");
+  if (xdg && xdg[0] == '/')
+    snprintf(dir, sizeof(dir), "%s", xdg);
+  else if (home)
+    snprintf(dir, sizeof(dir), "%s/.cache", home);
+  else
+    return 0;
+  mkdir(dir, 0755);
+  size_t len = strlen(dir);
+  snprintf(dir + len, sizeof(dir) - len, "/%s", CHART_CACHE_DIR);
+  if (mkdir(dir, 0755) != 0 && errno != EEXIST)
+    return 0;
+
+  // Keyed on the resolved path so different spellings share one file
+  char real[4096];
+  const char *key = realpath(notes_path, real) ? real : notes_path;
+  uint64_t h = hash_bytes(key, strlen(key), HASH_SEED);
+  return snprintf(out, size, "%s/%016llx.ghc", dir, (unsigned long long)h) <
+         (int)size;
+}
+
+static size_t table_count(const CompiledChart *cc) {
+  return (size_t)4 * (size_t)cc->track_slots;
+}
+
+// Copies the next `size` bytes of the mapped file into a new allocation, so
+// the vectors own their memory as if freshly built. Each piece is chained
+// into *ph the way cache_write() hashed it: where a buffer's words start
+// changes the hash. A failed allocation sets *oom and the read is dropped.
+static void *copy_out(const uint8_t **p, size_t size, uint64_t *ph, int *oom) {
+  *ph = hash_bytes(*p, size, *ph);
+  if (size == 0)
+    return NULL;
+  void *v = malloc(size);
+  if (v)
+    memcpy(v, *p, size);
+  else
+    *oom = 1;
+  *p += size;
+  return v;
+}
+
+static int cache_read(const char *path, const GhcHeader *want, CompiledChart *cc) {
+  size_t sz;
+  struct stat st;
+  const uint8_t *map = map_file(path, &sz, &st);
+  if (!map)
+    return -1;
+
+  int ok = 0;
+  GhcHeader h;
+  if (sz < sizeof(h))
+    goto done;
+  memcpy(&h, map, sizeof(h));
+  if (h.magic != GHC_MAGIC || h.version != CHART_CACHE_VERSION ||
+      h.note_size != sizeof(NoteOn) || h.track_name_size != sizeof(TrackName) ||
+      h.chord_size != GHC_CHORD_SIZE || h.hopo_ticks != want->hopo_ticks ||
+      h.src_size != want->src_size || h.src_mtime_ns != want->src_mtime_ns ||
+      h.src_hash != want->src_hash || h.max_track < 0 ||
+      h.max_track > CHART_CACHE_MAX_TRACK)
+    goto done;
+
+  size_t tables = (size_t)4 * (size_t)(h.max_track + 2);
+  uint64_t payload = h.note_count * sizeof(NoteOn) +
+                     h.track_name_count * sizeof(TrackName) +
+                     tables * sizeof(uint64_t) + h.chord_count * GHC_CHORD_SIZE;
+  if (h.note_count > sz || h.track_name_count > sz || h.chord_count > sz ||
+      payload != sz - sizeof(h))
+    goto done;
+
+  const uint8_t *p = map + sizeof(h);
+  uint64_t ph = HASH_SEED;
+  int oom = 0;
+  cc->max_track = h.max_track;
+  cc->hopo_ticks = h.hopo_ticks;
+  cc->track_slots = h.max_track + 2;
+
+  cc->notes.n = cc->notes.cap = (size_t)h.note_count;
+  cc->notes.v = (NoteOn *)copy_out(&p, cc->notes.n * sizeof(NoteOn), &ph, &oom);
+  cc->track_names.n = cc->track_names.cap = (size_t)h.track_name_count;
+  cc->track_names.v =
+      (TrackName *)copy_out(&p, cc->track_names.n * sizeof(TrackName), &ph, &oom);
+
+  const uint8_t *counts = p;
+  ph = hash_bytes(counts, tables * sizeof(uint64_t), ph);
+  p += tables * sizeof(uint64_t);
+  uint64_t total = 0;
+  cc->chords = (ChordVec *)calloc(tables, sizeof(ChordVec));
+  if (!cc->chords) {
+    chart_cache_free(cc);
+    goto done;
+  }
+  for (size_t i = 0; i < tables; i++) {
+    uint64_t n;
+    memcpy(&n, counts + i * sizeof(n), sizeof(n));
+    total += n;
+    if (total > h.chord_count)
+      break;  // Counts disagree with the header: the hash check fails below
+    ChordVec *cv = &cc->chords[i];
+    cv->n = cv->cap = (size_t)n;
+    cv->t_us = (int64_t *)copy_out(&p, cv->n * sizeof(int64_t), &ph, &oom);
+    cv->end_us = (int64_t *)copy_out(&p, cv->n * sizeof(int64_t), &ph, &oom);
+    cv->max_end_us = (int64_t *)copy_out(&p, cv->n * sizeof(int64_t), &ph, &oom);
+    cv->mask = (uint8_t *)copy_out(&p, cv->n, &ph, &oom);
+    cv->is_hopo = (uint8_t *)copy_out(&p, cv->n, &ph, &oom);
+  }
+  if (oom || total != h.chord_count || ph != h.payload_hash) {
+    chart_cache_free(cc);
+    goto done;
+  }
+  ok = 1;
+
+done:
+  munmap((void *)map, sz);
+  return ok ? 0 : -1;
+}
+
+// Writes one piece of the payload and chains it into *ph
+static int put(FILE *f, const void *data, size_t size, uint64_t *ph) {
+  *ph = hash_bytes(data, size, *ph);
+  return size == 0 || fwrite(data, size, 1, f) == 1;
+}
+
+// Written under a temporary name and renamed, so a crash or a second
+// instance never leaves a torn file behind. The header goes in last, once
+// the payload hash is known.
+static void cache_write(const char *path, GhcHeader h, const CompiledChart *cc) {
+  size_t tables = table_count(cc);
+  uint64_t *counts = (uint64_t *)malloc(tables * sizeof(uint64_t));
+  if (!counts)
+    return;
+  h.chord_count = 0;
+  for (size_t i = 0; i < tables; i++) {
+    counts[i] = cc->chords[i].n;
+    h.chord_count += counts[i];
+  }
+  h.note_count = cc->notes.n;
+  h.track_name_count = cc->track_names.n;
+
+  char tmp[4200];
+  snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", path, (long)getpid());
+  FILE *f = fopen(tmp, "wb");
+  if (!f) {
+    free(counts);
+    return;
+  }
+  uint64_t ph = HASH_SEED;
+  int ok = fseek(f, (long)sizeof(h), SEEK_SET) == 0;
+  ok &= put(f, cc->notes.v, cc->notes.n * sizeof(NoteOn), &ph);
+  ok &= put(f, cc->track_names.v, cc->track_names.n * sizeof(TrackName), &ph);
+  ok &= put(f, counts, tables * sizeof(uint64_t), &ph);
+  for (size_t i = 0; i < tables; i++) {
+    const ChordVec *cv = &cc->chords[i];
+    ok &= put(f, cv->t_us, cv->n * sizeof(int64_t), &ph);
+    ok &= put(f, cv->end_us, cv->n * sizeof(int64_t), &ph);
+    ok &= put(f, cv->max_end_us, cv->n * sizeof(int64_t), &ph);
+    ok &= put(f, cv->mask, cv->n, &ph);
+    ok &= put(f, cv->is_hopo, cv->n, &ph);
+  }
+  h.payload_hash = ph;
+  ok &= fseek(f, 0, SEEK_SET) == 0;
+  ok &= fwrite(&h, sizeof(h), 1, f) == 1;
+  ok &= fclose(f) == 0;
+  free(counts);
+
+  if (!ok || rename(tmp, path) != 0) {
+    fprintf(stderr, "Could not write chart cache %s\n", path);
+    unlink(tmp);
+  }
+}
+
+// Full path: parse the source and build every chord table
+static int compile(const char *notes_path, int is_chart, int hopo_ticks,
+                   CompiledChart *cc, LoadError *err) {
+  if (is_chart) {
+    fprintf(stderr, "Parsing .chart file: %s\n", notes_path);
+    if (chart_parse(notes_path, &cc->notes, &cc->track_names, err) != 0)
+      return -1;
+  } else {
+    fprintf(stderr, "Parsing MIDI: %s\n", notes_path);
+    if (midi_parse(notes_path, &cc->notes, &cc->track_names, err) != 0)
+      return -1;
+  }
+
+  cc->max_track = 0;
+  for (size_t i = 0; i < cc->notes.n; i++)
+    if (cc->notes.v[i].track > cc->max_track)
+      cc->max_track = cc->notes.v[i].track;
+  if (cc->max_track > CHART_CACHE_MAX_TRACK)
+    cc->max_track = CHART_CACHE_MAX_TRACK;
+  cc->hopo_ticks = hopo_ticks;
+  cc->track_slots = cc->max_track + 2;
+
+  cc->chords = (ChordVec *)calloc(table_count(cc), sizeof(ChordVec));
+  if (!cc->chords ||
+      build_chord_tables(&cc->notes, cc->max_track, hopo_ticks, cc->chords) != 0)
+    return load_fail(err, LOAD_ERR_NOMEM, notes_path, LOAD_NO_OFFSET,
+                     "out of memory building chords");
+  return 0;
+}
+
+int chart_cache_load(const char *notes_path, int is_chart, int hopo_ticks,
+                     CompiledChart *out, LoadError *err) {
+  memset(out, 0, sizeof(*out));
+
+  // The key covers the source's size, mtime and contents, so an edited
+  // chart is recompiled even if its size and mtime happen to match
+  size_t src_sz;
+  struct stat st;
+  const uint8_t *src = map_file(notes_path, &src_sz, &st);
+  if (!src) {
+    if (errno == 0)
+      return load_fail(err, LOAD_ERR_FORMAT, notes_path, 0, "empty notes file");
+    return load_fail(err, LOAD_ERR_IO, notes_path, LOAD_NO_OFFSET, "cannot read");
+  }
+  GhcHeader h = {
+      .magic = GHC_MAGIC,
+      .version = CHART_CACHE_VERSION,
+      .note_size = sizeof(NoteOn),
+      .track_name_size = sizeof(TrackName),
+      .chord_size = GHC_CHORD_SIZE,
+      .hopo_ticks = hopo_ticks,
+      .src_size = src_sz,
+      .src_mtime_ns = mtime_ns(&st),
+      .src_hash = hash_bytes(src, src_sz, HASH_SEED),
+  };
+  munmap((void *)src, src_sz);
+
+  char path[4096];
+  int cacheable = cache_path(notes_path, path, sizeof(path));
+  if (cacheable && cache_read(path, &h, out) == 0) {
+    fprintf(stderr, "Loaded compiled chart: %s\n", path);
+    return 0;
+  }
+
+  if (compile(notes_path, is_chart, hopo_ticks, out, err) != 0) {
+    chart_cache_free(out);
+    return -1;
+  }
+  if (cacheable && out->notes.n > 0) {
+    h.max_track = out->max_track;
+    cache_write(path, h, out);
+  }
+  return 0;
+}
+
+void chart_cache_free(CompiledChart *cc) {
+  if (cc->chords)
+    for (size_t i = 0; i < table_count(cc); i++)
+      cv_free(&cc->chords[i]);
+  free(cc->chords);
+  free(cc->notes.v);
+  free(cc->track_names.v);
+  memset(cc, 0, sizeof(*cc));
+}
+
+const ChordVec *chart_cache_chords(const CompiledChart *cc, int diff, int track) {
+  if (diff < 0 || diff > 3 || track < -1 || track > cc->max_track || !cc->chords)
+    return &g_no_chords;
+  return &cc->chords[diff * cc->track_slots + track + 1];
+}
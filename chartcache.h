@@ -0,0 +1,28 @@
+#ifndef CHARTCACHE_H
+#define CHARTCACHE_H
+
+#include "midi.h"
+
+// A song's notes with the chords of every (difficulty, track) pair already
+// built. Loaded from a compiled .ghc file in the cache directory when one
+// matches the source chart, otherwise parsed, built and written back.
+typedef struct {
+  NoteVec notes;
+  TrackNameVec track_names;
+  int max_track;
+  int hopo_ticks;   // HOPO threshold the chords were built with
+  int track_slots;  // max_track + 2: all tracks, then one per track
+  ChordVec *chords;  // [diff * track_slots + track + 1]
+} CompiledChart;
+
+// is_chart selects the .chart parser over the MIDI one. Returns 0 on
+// success, -1 with *err (may be NULL) filled in if the notes file cannot be
+// read or parsed; *out is then empty.
+int chart_cache_load(const char *notes_path, int is_chart, int hopo_ticks,
+                     CompiledChart *out, LoadError *err);
+void chart_cache_free(CompiledChart *cc);
+
+// track -1 selects all tracks. Out of range pairs give an empty vector.
+const ChordVec *chart_cache_chords(const CompiledChart *cc, int diff, int track);
+
+#endif
@@ -18,8 +18,25 @@
 #define DEFAULT_LOOKAHEAD 2.0
 #define MIN_LOOKAHEAD 0.5
 
-/* Target frame rate */
+/* Chords stay drawn until their head and sustain end are this far (us)
+   past the fret line */
+#define VISIBLE_PAST_US 300000
+
+/* Default frame rate, and the range offered in Options */
 #define TARGET_FPS 60.0
+#define FPS_MIN 30
+#define FPS_MAX 240
+
+/* Frame pacer: in precise mode wake this early (us) and spin to the
+   deadline; lateness histogram resolution */
+#define PACER_SPIN_US       300
+#define PACER_HIST_STEP_US  50
+#define PACER_HIST_BUCKETS  100
+
+/* Fixed simulation rate (misses, sustains, effects, timers), independent of
+   the frame rate; at most SIM_MAX_STEPS are caught up after a stall */
+#define SIM_HZ        240
+#define SIM_MAX_STEPS 24
 
 /* Performance tracking window size (for sound reaction) */
 #define PERF_WINDOW 3  // Very small window = very fast reaction
@@ -29,10 +46,14 @@
 
 /* ==================== Timing Windows ==================== */
 
-/* Hit timing windows in seconds */
-#define TIMING_PERFECT 0.030  // 30ms - perfect hit
-#define TIMING_GOOD    0.055  // 55ms - good hit
-#define TIMING_BAD     0.120  // 100ms - acceptable hit
+/* Hit timing windows in microseconds of song time */
+#define TIMING_PERFECT_US 30000   // 30ms - perfect hit
+#define TIMING_GOOD_US    55000   // 55ms - good hit
+#define TIMING_BAD_US     120000  // 120ms - acceptable hit
+
+/* Inputs are judged at their event timestamp, back-dated at most this far
+   (microseconds) from the moment they are processed */
+#define INPUT_MAX_AGE_US 100000
 
 /* Points awarded for each timing quality */
 #define POINTS_PERFECT 100
@@ -72,16 +93,34 @@
 #define KEY_TRACK_MIN    SDLK_1
 #define KEY_TRACK_MAX    SDLK_9
 
+/* Difficulty switching mid-song */
+#define KEY_DIFF_DOWN    SDLK_LEFTBRACKET
+#define KEY_DIFF_UP      SDLK_RIGHTBRACKET
+
 /* Game control */
 #define KEY_QUIT         SDLK_q
-#define KEY_MENU         SDLK_ESCAPE
+#define KEY_PAUSE_MENU   SDLK_ESCAPE
 #define KEY_START        SDLK_RETURN
 #define KEY_START2       SDLK_RETURN2
 
+/* Debug overlays */
+#define KEY_AUDIO_STATS  SDLK_F3
+
 /* ==================== Audio Configuration ==================== */
 
-/* SDL audio buffer size in frames (affects latency) */
-#define AUDIO_BUFFER_SIZE 256  // Increased for WSL2 thread scheduling tolerance
+/* SDL audio buffer size in frames (affects latency).
+   The size is a runtime setting; 0 selects auto-tune, which starts one step
+   below the last size it settled on, doubles whenever the callback keeps
+   underrunning and halves again after a long run without underruns. */
+#define DEFAULT_AUDIO_BUFFER 0
+#define AUDIO_BUFFER_MIN 64
+#define AUDIO_BUFFER_MAX 4096
+
+/* Auto-tune grows the buffer after this many underruns within the window */
+#define AUDIO_AUTOTUNE_UNDERRUNS 3
+#define AUDIO_AUTOTUNE_WINDOW    5.0  // Seconds
+/* ...and shrinks it after this many windows in a row without one */
+#define AUDIO_AUTOTUNE_CLEAN_WINDOWS 12
 
 /* Audio sample rate (Opus is 48kHz) */
 #define AUDIO_SAMPLE_RATE 48000
@@ -92,6 +131,23 @@
 /* Latency compensation multiplier */
 #define LATENCY_BUFFER_MULT 2
 
+/* SCHED_FIFO priority for the audio callback thread in real-time mode */
+#define AUDIO_RT_PRIORITY 60
+
+/* Callback timing histogram: bucket i counts durations in [2^(i-1), 2^i) us */
+#define AUDIO_HIST_BUCKETS 20
+
+/* The callback thread reads its own page fault counters every this many
+   callbacks (one getrusage call) */
+#define AUDIO_FAULT_SAMPLE_CALLBACKS 64
+
+/* One-shot sound effects (must be a power of 2) */
+#define SFX_QUEUE_SIZE 64
+#define SFX_MAX_VOICES 8  // When all are busy, the one nearest its end is stolen
+
+/* Sound effect volume relative to the song */
+#define SFX_GAIN 0.5f
+
 /* ==================== Visual Effects ==================== */
 
 /* Maximum concurrent visual effects */
@@ -151,6 +207,25 @@
 /* Default tempo (120 BPM in microseconds per quarter note) */
 #define DEFAULT_TEMPO_USPQN 500000
 
+/* Every MIDI note ends with a note-off; only notes held longer than
+   1/MIDI_SUSTAIN_CUTOFF_DIV of a quarter note become sustains */
+#define MIDI_SUSTAIN_CUTOFF_DIV 3
+
+/* Overlapping note-ons of one pitch in a track awaiting their note-off */
+#define MIDI_OPEN_NOTE_DEPTH 4
+
+/* ==================== Chart Cache ==================== */
+
+/* Compiled charts (.ghc) live in $XDG_CACHE_HOME (or ~/.cache) under this
+   directory. Bump the version when the file layout or chord building
+   changes, so stale files are rebuilt. */
+#define CHART_CACHE_DIR     "midifall"
+#define CHART_CACHE_VERSION 3
+
+/* Tracks above this get no chord table of their own (still part of the
+   all-tracks table) */
+#define CHART_CACHE_MAX_TRACK 63
+
 /* ==================== Memory Limits ==================== */
 
 /* Initial vector capacities */
@@ -176,6 +251,21 @@
 #define SDL_WINDOW_WIDTH  400
 #define SDL_WINDOW_HEIGHT 1
 
+/* Input thread: polling rate (Hz) and event queue depth (power of two) */
+#define INPUT_POLL_HZ    1000
+#define INPUT_QUEUE_SIZE 256
+
+/* evdev/kitty backends block in poll(); this timeout (ms) only bounds how
+   long stopping the input thread takes, events are read as they arrive */
+#define INPUT_WAIT_MS 50
+
+/* evdev backend: at most this many devices are opened by "auto" */
+#define INPUT_EVDEV_MAX_DEVICES 8
+#define DEFAULT_EVDEV_DEVICE    "auto"
+
+/* kitty backend: how long to wait for the terminal to answer the query (ms) */
+#define INPUT_KITTY_DETECT_MS 200
+
 /* Preferred video driver for WSL */
 // x11, Wayland
 #define SDL_VIDEO_DRIVER "x11"
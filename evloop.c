@@ -0,0 +1,123 @@
+#define _DEFAULT_SOURCE
+#define _POSIX_C_SOURCE 200809L
+
+#include "evloop.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
+
+// epoll_event.data.u32 tags
+enum { SRC_TICK, SRC_WAKE, SRC_SIGNAL, SRC_STDIN };
+
+static int epoll_watch(int epfd, int op, int fd, uint32_t tag) {
+  struct epoll_event ev = {.events = EPOLLIN, .data.u32 = tag};
+  return epoll_ctl(epfd, op, fd, &ev);
+}
+
+int evloop_init(EventLoop *l) {
+  memset(l, 0, sizeof(*l));
+  l->epfd = l->wake_fd = l->signal_fd = l->tick_fd = -1;
+
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGTERM);
+  sigaddset(&mask, SIGWINCH);
+  pthread_sigmask(SIG_BLOCK, &mask, &l->old_mask);
+
+  l->epfd = epoll_create1(EPOLL_CLOEXEC);
+  l->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  l->signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (l->epfd < 0 || l->wake_fd < 0 || l->signal_fd < 0 ||
+      epoll_watch(l->epfd, EPOLL_CTL_ADD, l->wake_fd, SRC_WAKE) < 0 ||
+      epoll_watch(l->epfd, EPOLL_CTL_ADD, l->signal_fd, SRC_SIGNAL) < 0) {
+    perror("evloop_init");
+    evloop_close(l);
+    return -1;
+  }
+  return 0;
+}
+
+void evloop_close(EventLoop *l) {
+  if (l->epfd < 0 && l->wake_fd < 0 && l->signal_fd < 0)
+    return;  // Never initialized, or already closed
+  if (l->epfd >= 0)
+    close(l->epfd);
+  if (l->wake_fd >= 0)
+    close(l->wake_fd);
+  if (l->signal_fd >= 0)
+    close(l->signal_fd);
+  l->epfd = l->wake_fd = l->signal_fd = l->tick_fd = -1;
+  l->stdin_watched = 0;
+  pthread_sigmask(SIG_SETMASK, &l->old_mask, NULL);
+}
+
+void evloop_set_tick(EventLoop *l, int timer_fd) {
+  if (l->tick_fd >= 0)
+    epoll_ctl(l->epfd, EPOLL_CTL_DEL, l->tick_fd, NULL);
+  l->tick_fd = -1;
+  if (timer_fd >= 0 && epoll_watch(l->epfd, EPOLL_CTL_ADD, timer_fd, SRC_TICK) == 0)
+    l->tick_fd = timer_fd;
+}
+
+void evloop_watch_stdin(EventLoop *l, int on) {
+  if (on == l->stdin_watched)
+    return;
+  if (on && epoll_watch(l->epfd, EPOLL_CTL_ADD, STDIN_FILENO, SRC_STDIN) < 0)
+    return;  // Not pollable (a regular file): nothing to wait for
+  if (!on)
+    epoll_ctl(l->epfd, EPOLL_CTL_DEL, STDIN_FILENO, NULL);
+  l->stdin_watched = on;
+}
+
+int evloop_wait(EventLoop *l, int timeout_ms) {
+  struct epoll_event evs[8];
+  int n = epoll_wait(l->epfd, evs, 8, timeout_ms);
+  if (n < 0)
+    return 0;  // EINTR: let the caller look around and wait again
+
+  int ready = 0;
+  for (int i = 0; i < n; i++) {
+    switch (evs[i].data.u32) {
+    case SRC_TICK:
+      ready |= LOOP_TICK;
+      break;
+    case SRC_WAKE: {
+      uint64_t count;
+      ssize_t r = read(l->wake_fd, &count, sizeof(count));
+      (void)r;
+      ready |= LOOP_INPUT;
+      break;
+    }
+    case SRC_SIGNAL: {
+      struct signalfd_siginfo si;
+      while (read(l->signal_fd, &si, sizeof(si)) == (ssize_t)sizeof(si))
+        ready |= (si.ssi_signo == SIGWINCH) ? LOOP_RESIZE : LOOP_INTERRUPT;
+      break;
+    }
+    case SRC_STDIN:
+      if (evs[i].events & (EPOLLHUP | EPOLLERR)) {
+        // Terminal went away: stop watching it or epoll reports it forever
+        evloop_watch_stdin(l, 0);
+        ready |= LOOP_INTERRUPT;
+      } else {
+        ready |= LOOP_STDIN;
+      }
+      break;
+    }
+  }
+  return ready;
+}
+
+void evloop_wake(int wake_fd) {
+  if (wake_fd < 0)
+    return;
+  uint64_t one = 1;
+  ssize_t r = write(wake_fd, &one, sizeof(one));
+  (void)r;  // EAGAIN only when the counter is saturated: already awake
+}
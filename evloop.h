@@ -0,0 +1,40 @@
+#ifndef EVLOOP_H
+#define EVLOOP_H
+
+#include <signal.h>
+
+// Sources reported by evloop_wait, OR-ed together
+typedef enum {
+  LOOP_TICK = 1 << 0,       // Frame timer expired (caller reads it)
+  LOOP_INPUT = 1 << 1,      // Input thread queued events
+  LOOP_STDIN = 1 << 2,      // Terminal bytes pending on stdin
+  LOOP_RESIZE = 1 << 3,     // SIGWINCH
+  LOOP_INTERRUPT = 1 << 4,  // SIGINT/SIGTERM, or the terminal hung up
+} LoopEvent;
+
+// Single epoll wait for everything the game thread reacts to, so it sleeps
+// until there is work instead of polling on a short delay.
+typedef struct {
+  int epfd;
+  int wake_fd;    // eventfd other threads write to through evloop_wake()
+  int signal_fd;  // SIGINT/SIGTERM/SIGWINCH, blocked for normal delivery
+  int tick_fd;    // Frame timerfd, -1 when none is attached
+  int stdin_watched;
+  sigset_t old_mask;
+} EventLoop;
+
+// Blocks the loop's signals in the calling thread, so call it before any
+// thread that should inherit the mask is started. Returns -1 on failure.
+int evloop_init(EventLoop *l);
+void evloop_close(EventLoop *l);  // Also restores the signal mask
+
+void evloop_set_tick(EventLoop *l, int timer_fd);  // -1 detaches
+void evloop_watch_stdin(EventLoop *l, int on);
+
+// Wait up to timeout_ms (-1 = forever); returns the LoopEvent bits that fired.
+int evloop_wait(EventLoop *l, int timeout_ms);
+
+// Safe from any thread: bumps the eventfd behind LOOP_INPUT.
+void evloop_wake(int wake_fd);
+
+#endif
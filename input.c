@@ -0,0 +1,178 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "input.h"
+#include "config.h"
+#include "evloop.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+uint64_t input_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void input_push(InputThread *in, InputEventType type, SDL_Keycode key, uint64_t t_ns) {
+  uint32_t head = atomic_load_explicit(&in->head, memory_order_relaxed);
+  uint32_t tail = atomic_load_explicit(&in->tail, memory_order_acquire);
+  if (head - tail >= INPUT_QUEUE_SIZE) {
+    atomic_fetch_add_explicit(&in->dropped, 1, memory_order_relaxed);
+    return;  // Game thread stalled; never block input
+  }
+  in->queue[head & (INPUT_QUEUE_SIZE - 1)] = (InputEvent){.type = type, .key = key, .t_ns = t_ns};
+  atomic_store_explicit(&in->head, head + 1, memory_order_release);
+  evloop_wake(in->wake_fd);
+}
+
+static SDL_Window *create_input_window(void) {
+  SDL_Window *window =
+      SDL_CreateWindow(SDL_WINDOW_TITLE, 0, 0,  // Top-left corner
+                       SDL_WINDOW_WIDTH, SDL_WINDOW_HEIGHT,
+                       SDL_WINDOW_SHOWN | SDL_WINDOW_INPUT_FOCUS);
+  if (!window) {
+    fprintf(stderr, "SDL_CreateWindow failed: %s\n", SDL_GetError());
+    fprintf(stderr, "Check that WSLg is working: wsl --update\n");
+    return NULL;
+  }
+
+  SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE);
+  if (renderer) {
+    SDL_SetRenderDrawColor(renderer, 30, 30, 30, 255);
+    SDL_RenderClear(renderer);
+    SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255);
+    SDL_Rect r = {10, 10, 380, 130};
+    SDL_RenderDrawRect(renderer, &r);
+    SDL_RenderPresent(renderer);
+  }
+  return window;
+}
+
+// Video is initialized, the window created and events pumped all on this
+// thread, as SDL requires, so event handling never waits on the render loop.
+static int input_thread(void *userdata) {
+  InputThread *in = (InputThread *)userdata;
+  if (SDL_InitSubSystem(SDL_INIT_VIDEO) != 0) {
+    fprintf(stderr, "SDL video init failed: %s\n", SDL_GetError());
+    fprintf(stderr, "Make sure WSLg is enabled (wsl --update)\n");
+    atomic_store(&in->state, -1);
+    return 1;
+  }
+  SDL_Window *window = create_input_window();
+  if (!window) {
+    SDL_QuitSubSystem(SDL_INIT_VIDEO);
+    atomic_store(&in->state, -1);
+    return 1;
+  }
+  SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH);
+  atomic_store(&in->state, 1);
+
+  const long period_ns = 1000000000l / INPUT_POLL_HZ;
+  struct timespec next;
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  while (!atomic_load_explicit(&in->quit, memory_order_relaxed)) {
+    SDL_Event e;
+    while (SDL_PollEvent(&e)) {
+      uint64_t now = input_now_ns();
+      switch (e.type) {
+      case SDL_QUIT:
+        input_push(in, INPUT_QUIT, 0, now);
+        break;
+      case SDL_WINDOWEVENT:
+        if (e.window.event == SDL_WINDOWEVENT_FOCUS_LOST)
+          input_push(in, INPUT_FOCUS_LOST, 0, now);
+        break;
+      case SDL_KEYDOWN:
+        if (e.key.repeat == 0)
+          input_push(in, INPUT_KEY_DOWN, e.key.keysym.sym, now);
+        break;
+      case SDL_KEYUP:
+        input_push(in, INPUT_KEY_UP, e.key.keysym.sym, now);
+        break;
+      }
+    }
+
+    if (atomic_exchange_explicit(&in->raise, 0, memory_order_relaxed) &&
+        (SDL_GetWindowFlags(window) & SDL_WINDOW_INPUT_FOCUS) == 0)
+      SDL_RaiseWindow(window);
+
+    next.tv_nsec += period_ns;
+    while (next.tv_nsec >= 1000000000l) {
+      next.tv_nsec -= 1000000000l;
+      next.tv_sec++;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+  }
+
+  SDL_DestroyWindow(window);  // Also frees the renderer
+  SDL_QuitSubSystem(SDL_INIT_VIDEO);
+  return 0;
+}
+
+const char *input_backend_name(InputBackend backend) {
+  switch (backend) {
+  case INPUT_BACKEND_SDL:
+    return "SDL window";
+  case INPUT_BACKEND_EVDEV:
+    return "evdev";
+  case INPUT_BACKEND_KITTY:
+    return "Terminal (kitty)";
+  default:
+    return "?";
+  }
+}
+
+int input_start(InputThread *in, InputBackend backend, const char *device,
+                int wake_fd) {
+  memset(in, 0, sizeof(*in));
+  in->backend = backend;
+  in->wake_fd = wake_fd;
+  snprintf(in->device, sizeof(in->device), "%s", device ? device : "auto");
+  atomic_init(&in->head, 0);
+  atomic_init(&in->tail, 0);
+  atomic_init(&in->dropped, 0);
+  atomic_init(&in->quit, 0);
+  atomic_init(&in->state, 0);
+  atomic_init(&in->raise, 0);
+
+  SDL_ThreadFunction fn = input_thread;
+  if (backend == INPUT_BACKEND_EVDEV)
+    fn = input_evdev_thread;
+  else if (backend == INPUT_BACKEND_KITTY)
+    fn = input_kitty_thread;
+  in->thread = SDL_CreateThread(fn, "input", in);
+  if (!in->thread) {
+    fprintf(stderr, "SDL_CreateThread: %s\n", SDL_GetError());
+    return -1;
+  }
+  while (atomic_load(&in->state) == 0)
+    SDL_Delay(1);
+  if (atomic_load(&in->state) < 0) {
+    SDL_WaitThread(in->thread, NULL);
+    in->thread = NULL;
+    return -1;
+  }
+  return 0;
+}
+
+void input_stop(InputThread *in) {
+  if (!in->thread)
+    return;
+  atomic_store(&in->quit, 1);
+  SDL_WaitThread(in->thread, NULL);
+  in->thread = NULL;
+}
+
+int input_poll(InputThread *in, InputEvent *ev) {
+  uint32_t tail = atomic_load_explicit(&in->tail, memory_order_relaxed);
+  uint32_t head = atomic_load_explicit(&in->head, memory_order_acquire);
+  if (tail == head)
+    return 0;
+  *ev = in->queue[tail & (INPUT_QUEUE_SIZE - 1)];
+  atomic_store_explicit(&in->tail, tail + 1, memory_order_release);
+  return 1;
+}
+
+void input_raise(InputThread *in) {
+  atomic_store_explicit(&in->raise, 1, memory_order_relaxed);
+}
@@ -0,0 +1,67 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "config.h"
+#include <SDL2/SDL.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+typedef enum {
+  INPUT_BACKEND_SDL,    // Key events from a small SDL window
+  INPUT_BACKEND_EVDEV,  // Linux /dev/input/event*, no window needed
+  INPUT_BACKEND_KITTY,  // kitty keyboard protocol on stdin, no window needed
+  INPUT_BACKEND_COUNT
+} InputBackend;
+
+typedef enum {
+  INPUT_KEY_DOWN,
+  INPUT_KEY_UP,
+  INPUT_FOCUS_LOST,  // Held keys must be treated as released
+  INPUT_QUIT,
+} InputEventType;
+
+typedef struct {
+  InputEventType type;
+  SDL_Keycode key;
+  uint64_t t_ns;  // CLOCK_MONOTONIC time the event was read
+} InputEvent;
+
+// Input runs on its own thread, independent of the render loop. The thread
+// owns the backend (SDL window, evdev fds or stdin) and pushes timestamped events
+// into a single-producer/single-consumer queue drained by the game thread.
+typedef struct {
+  InputEvent queue[INPUT_QUEUE_SIZE];
+  _Atomic uint32_t head;  // Written by the input thread only
+  _Atomic uint32_t tail;  // Written by the game thread only
+  _Atomic uint32_t dropped;
+  _Atomic int quit;
+  _Atomic int state;  // 0 = starting, 1 = running, -1 = failed
+  _Atomic int raise;  // Game thread asks for the window to grab focus
+  SDL_Thread *thread;
+  int wake_fd;  // eventfd written after each push, -1 for none
+  InputBackend backend;
+  char device[256];  // evdev: device path or "auto"
+} InputThread;
+
+// Start the input thread; returns 0 once the backend is up, -1 on failure.
+// device is only used by the evdev backend. wake_fd (an eventfd, or -1) is
+// signalled whenever events are queued so the game thread can sleep.
+int input_start(InputThread *in, InputBackend backend, const char *device,
+                int wake_fd);
+void input_stop(InputThread *in);
+
+// Pop the next event; returns 0 when the queue is empty.
+int input_poll(InputThread *in, InputEvent *ev);
+
+// Ask the input thread to raise its window if it lost focus.
+void input_raise(InputThread *in);
+
+uint64_t input_now_ns(void);
+const char *input_backend_name(InputBackend backend);
+
+// Backend plumbing: producers run on the input thread only.
+void input_push(InputThread *in, InputEventType type, SDL_Keycode key, uint64_t t_ns);
+int input_evdev_thread(void *userdata);
+int input_kitty_thread(void *userdata);
+
+#endif
@@ -0,0 +1,190 @@
+#define _DEFAULT_SOURCE
+#define _POSIX_C_SOURCE 200809L
+
+// Kernel key codes first: a game binding in config.h that reused one of
+// their names would then be a redefinition warning instead of silently
+// taking the kernel's value
+#include <linux/input.h>
+#include "config.h"
+#include "input.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+// Linux key codes to the SDL keycodes used by Settings, so existing
+// bindings keep working without a window.
+static const SDL_Keycode g_keymap[KEY_F12 + 1] = {
+    [KEY_ESC] = SDLK_ESCAPE,       [KEY_1] = SDLK_1,
+    [KEY_2] = SDLK_2,              [KEY_3] = SDLK_3,
+    [KEY_4] = SDLK_4,              [KEY_5] = SDLK_5,
+    [KEY_6] = SDLK_6,              [KEY_7] = SDLK_7,
+    [KEY_8] = SDLK_8,              [KEY_9] = SDLK_9,
+    [KEY_0] = SDLK_0,              [KEY_MINUS] = SDLK_MINUS,
+    [KEY_EQUAL] = SDLK_EQUALS,     [KEY_BACKSPACE] = SDLK_BACKSPACE,
+    [KEY_TAB] = SDLK_TAB,          [KEY_Q] = SDLK_q,
+    [KEY_W] = SDLK_w,              [KEY_E] = SDLK_e,
+    [KEY_R] = SDLK_r,              [KEY_T] = SDLK_t,
+    [KEY_Y] = SDLK_y,              [KEY_U] = SDLK_u,
+    [KEY_I] = SDLK_i,              [KEY_O] = SDLK_o,
+    [KEY_P] = SDLK_p,              [KEY_LEFTBRACE] = SDLK_LEFTBRACKET,
+    [KEY_RIGHTBRACE] = SDLK_RIGHTBRACKET,
+    [KEY_ENTER] = SDLK_RETURN,     [KEY_LEFTCTRL] = SDLK_LCTRL,
+    [KEY_A] = SDLK_a,              [KEY_S] = SDLK_s,
+    [KEY_D] = SDLK_d,              [KEY_F] = SDLK_f,
+    [KEY_G] = SDLK_g,              [KEY_H] = SDLK_h,
+    [KEY_J] = SDLK_j,              [KEY_K] = SDLK_k,
+    [KEY_L] = SDLK_l,              [KEY_SEMICOLON] = SDLK_SEMICOLON,
+    [KEY_APOSTROPHE] = SDLK_QUOTE, [KEY_GRAVE] = SDLK_BACKQUOTE,
+    [KEY_LEFTSHIFT] = SDLK_LSHIFT, [KEY_BACKSLASH] = SDLK_BACKSLASH,
+    [KEY_Z] = SDLK_z,              [KEY_X] = SDLK_x,
+    [KEY_C] = SDLK_c,              [KEY_V] = SDLK_v,
+    [KEY_B] = SDLK_b,              [KEY_N] = SDLK_n,
+    [KEY_M] = SDLK_m,              [KEY_COMMA] = SDLK_COMMA,
+    [KEY_DOT] = SDLK_PERIOD,       [KEY_SLASH] = SDLK_SLASH,
+    [KEY_RIGHTSHIFT] = SDLK_RSHIFT, [KEY_KPASTERISK] = SDLK_KP_MULTIPLY,
+    [KEY_LEFTALT] = SDLK_LALT,     [KEY_SPACE] = SDLK_SPACE,
+    [KEY_F1] = SDLK_F1,            [KEY_F2] = SDLK_F2,
+    [KEY_F3] = SDLK_F3,            [KEY_F4] = SDLK_F4,
+    [KEY_F5] = SDLK_F5,            [KEY_F6] = SDLK_F6,
+    [KEY_F7] = SDLK_F7,            [KEY_F8] = SDLK_F8,
+    [KEY_F9] = SDLK_F9,            [KEY_F10] = SDLK_F10,
+    [KEY_KP7] = SDLK_KP_7,         [KEY_KP8] = SDLK_KP_8,
+    [KEY_KP9] = SDLK_KP_9,         [KEY_KPMINUS] = SDLK_KP_MINUS,
+    [KEY_KP4] = SDLK_KP_4,         [KEY_KP5] = SDLK_KP_5,
+    [KEY_KP6] = SDLK_KP_6,         [KEY_KPPLUS] = SDLK_KP_PLUS,
+    [KEY_KP1] = SDLK_KP_1,         [KEY_KP2] = SDLK_KP_2,
+    [KEY_KP3] = SDLK_KP_3,         [KEY_KP0] = SDLK_KP_0,
+    [KEY_F11] = SDLK_F11,          [KEY_F12] = SDLK_F12,
+};
+
+static SDL_Keycode evdev_to_sdl(unsigned code) {
+  if (code < sizeof(g_keymap) / sizeof(g_keymap[0]))
+    return g_keymap[code];
+  switch (code) {
+  case KEY_KPENTER: return SDLK_KP_ENTER;
+  case KEY_RIGHTCTRL: return SDLK_RCTRL;
+  case KEY_RIGHTALT: return SDLK_RALT;
+  case KEY_UP: return SDLK_UP;
+  case KEY_DOWN: return SDLK_DOWN;
+  case KEY_LEFT: return SDLK_LEFT;
+  case KEY_RIGHT: return SDLK_RIGHT;
+  default: return SDLK_UNKNOWN;
+  }
+}
+
+#define BITS_PER_LONG (sizeof(unsigned long) * 8)
+#define TEST_BIT(bits, n) (((bits)[(n) / BITS_PER_LONG] >> ((n) % BITS_PER_LONG)) & 1)
+
+// Auto-detect only picks devices that can type the default fret keys
+static int evdev_is_keyboard(int fd) {
+  unsigned long keys[KEY_MAX / BITS_PER_LONG + 1];
+  memset(keys, 0, sizeof(keys));
+  if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keys)), keys) < 0)
+    return 0;
+  return TEST_BIT(keys, KEY_Z) && TEST_BIT(keys, KEY_ENTER);
+}
+
+// Returns the fd, or -1. *kernel_clock is set when event timestamps are on
+// CLOCK_MONOTONIC and can be used as-is.
+static int evdev_open(const char *path, int require_keyboard, int *kernel_clock) {
+  int fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0)
+    return -1;
+  if (require_keyboard && !evdev_is_keyboard(fd)) {
+    close(fd);
+    return -1;
+  }
+  int clk = CLOCK_MONOTONIC;
+  *kernel_clock = (ioctl(fd, EVIOCSCLOCKID, &clk) == 0);
+  return fd;
+}
+
+int input_evdev_thread(void *userdata) {
+  InputThread *in = (InputThread *)userdata;
+  struct pollfd fds[INPUT_EVDEV_MAX_DEVICES];
+  int kernel_clock[INPUT_EVDEV_MAX_DEVICES];
+  int nfds = 0;
+  int denied = 0;
+
+  if (strcmp(in->device, "auto") == 0) {
+    for (int i = 0; i < 64 && nfds < INPUT_EVDEV_MAX_DEVICES; i++) {
+      char path[64];
+      snprintf(path, sizeof(path), "/dev/input/event%d", i);
+      int fd = evdev_open(path, 1, &kernel_clock[nfds]);
+      if (fd < 0) {
+        denied |= (errno == EACCES);
+        continue;
+      }
+      char name[128] = "?";
+      ioctl(fd, EVIOCGNAME(sizeof(name)), name);
+      fprintf(stderr, "[input] evdev %s: %s\n", path, name);
+      fds[nfds++] = (struct pollfd){.fd = fd, .events = POLLIN};
+    }
+  } else {
+    int fd = evdev_open(in->device, 0, &kernel_clock[0]);
+    if (fd >= 0)
+      fds[nfds++] = (struct pollfd){.fd = fd, .events = POLLIN};
+    denied = (fd < 0 && errno == EACCES);
+  }
+
+  if (nfds == 0) {
+    fprintf(stderr, "[input] no evdev keyboard at %s%s\n", in->device,
+            denied ? " (permission denied; join the 'input' group)" : "");
+    atomic_store(&in->state, -1);
+    return 1;
+  }
+  SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH);
+  atomic_store(&in->state, 1);
+
+  // Blocks in poll(), so events are read as soon as the kernel has them; the
+  // timeout only bounds how long input_stop() waits.
+  while (!atomic_load_explicit(&in->quit, memory_order_relaxed)) {
+    if (poll(fds, (nfds_t)nfds, INPUT_WAIT_MS) <= 0)
+      continue;
+
+    for (int d = 0; d < nfds; d++) {
+      if (!fds[d].revents)
+        continue;
+      struct input_event evs[64];
+      ssize_t n;
+      while ((n = read(fds[d].fd, evs, sizeof(evs))) > 0) {
+        uint64_t now = input_now_ns();
+        for (size_t i = 0; i < (size_t)n / sizeof(evs[0]); i++) {
+          const struct input_event *ev = &evs[i];
+          if (ev->type == EV_SYN && ev->code == SYN_DROPPED) {
+            // Kernel buffer overflowed: key state is unknown, release all
+            input_push(in, INPUT_FOCUS_LOST, 0, now);
+            continue;
+          }
+          if (ev->type != EV_KEY || ev->value == 2)  // Ignore autorepeat
+            continue;
+          SDL_Keycode key = evdev_to_sdl(ev->code);
+          if (key == SDLK_UNKNOWN)
+            continue;
+          uint64_t t_ns = now;
+          if (kernel_clock[d])
+            t_ns = (uint64_t)ev->input_event_sec * 1000000000ull +
+                   (uint64_t)ev->input_event_usec * 1000ull;
+          input_push(in, ev->value ? INPUT_KEY_DOWN : INPUT_KEY_UP, key, t_ns);
+        }
+      }
+      if ((n < 0 && errno != EAGAIN && errno != EINTR) ||
+          (fds[d].revents & (POLLERR | POLLHUP | POLLNVAL))) {
+        // Device unplugged: stop polling it, release anything it held
+        input_push(in, INPUT_FOCUS_LOST, 0, input_now_ns());
+        close(fds[d].fd);
+        fds[d].fd = -1;
+      }
+    }
+  }
+
+  for (int d = 0; d < nfds; d++)
+    if (fds[d].fd >= 0)
+      close(fds[d].fd);
+  return 0;
+}
@@ -0,0 +1,204 @@
+#define _DEFAULT_SOURCE
+#define _POSIX_C_SOURCE 200809L
+
+#include "config.h"
+#include "input.h"
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// kitty progressive keyboard enhancement, flags 1|2|8: disambiguate escape
+// codes, report press/repeat/release, report every key as an escape code.
+// https://sw.kovidgoyal.net/kitty/keyboard-protocol/
+#define KITTY_PUSH  "\x1b[>11u"
+#define KITTY_POP   "\x1b[<u"
+#define KITTY_QUERY "\x1b[?u\x1b[c"  // Flags query, then DA1 as a sentinel
+
+static volatile int g_kitty_active;
+
+static void kitty_write(const char *s) {
+  ssize_t n = write(STDOUT_FILENO, s, strlen(s));
+  (void)n;
+}
+
+// Registered with atexit so the terminal is never left in the enhanced mode
+static void kitty_pop(void) {
+  if (g_kitty_active) {
+    kitty_write(KITTY_POP);
+    g_kitty_active = 0;
+  }
+}
+
+typedef struct {
+  char buf[64];
+  int len;  // 0 = not inside an escape sequence
+} CsiParser;
+
+typedef struct {
+  char prefix;      // '?' for terminal replies, 0 for key events
+  char final;       // Final byte
+  int key;          // First parameter (key code, or number for '~')
+  int event;        // 1 press, 2 repeat, 3 release
+} CsiSeq;
+
+// Feed one byte; returns 1 when a complete CSI sequence was parsed into *out.
+static int csi_feed(CsiParser *p, char c, CsiSeq *out) {
+  if (c == 0x1b) {
+    p->buf[0] = c;
+    p->len = 1;
+    return 0;
+  }
+  if (p->len == 0)
+    return 0;  // Plain bytes never arrive in this mode except in replies
+  if (p->len == 1) {
+    p->len = (c == '[') ? 2 : 0;
+    return 0;
+  }
+  if ((unsigned char)c < 0x40 || (unsigned char)c > 0x7e) {
+    if (p->len < (int)sizeof(p->buf) - 1)
+      p->buf[p->len++] = c;
+    else
+      p->len = 0;  // Overlong: drop it
+    return 0;
+  }
+
+  // Final byte: parameters are "[?]key[:alt...];mods[:event][;text]"
+  p->buf[p->len] = '\0';
+  const char *s = p->buf + 2;
+  p->len = 0;
+  memset(out, 0, sizeof(*out));
+  out->final = c;
+  out->event = 1;
+  if (*s == '?' || *s == '>' || *s == '=')
+    out->prefix = *s++;
+  out->key = (int)strtol(s, (char **)&s, 10);
+  while (*s == ':')  // Shifted/base-layout alternates
+    strtol(s + 1, (char **)&s, 10);
+  if (*s == ';') {
+    strtol(s + 1, (char **)&s, 10);  // Modifiers
+    if (*s == ':')
+      out->event = (int)strtol(s + 1, (char **)&s, 10);
+  }
+  return 1;
+}
+
+static SDL_Keycode kitty_to_sdl(const CsiSeq *q) {
+  switch (q->final) {
+  case 'u':
+    break;
+  case 'A': return SDLK_UP;
+  case 'B': return SDLK_DOWN;
+  case 'C': return SDLK_RIGHT;
+  case 'D': return SDLK_LEFT;
+  case 'P': return SDLK_F1;
+  case 'Q': return SDLK_F2;
+  case 'S': return SDLK_F4;
+  case '~':
+    switch (q->key) {
+    case 13: return SDLK_F3;
+    case 15: return SDLK_F5;
+    case 17: return SDLK_F6;
+    case 18: return SDLK_F7;
+    case 19: return SDLK_F8;
+    case 20: return SDLK_F9;
+    case 21: return SDLK_F10;
+    case 23: return SDLK_F11;
+    case 24: return SDLK_F12;
+    default: return SDLK_UNKNOWN;
+    }
+  default:
+    return SDLK_UNKNOWN;
+  }
+
+  // Unicode key codes match SDL keycodes for ASCII; the rest live in the
+  // private use area
+  int k = q->key;
+  if (k == 13) return SDLK_RETURN;
+  if (k == 27) return SDLK_ESCAPE;
+  if (k == 9) return SDLK_TAB;
+  if (k == 127) return SDLK_BACKSPACE;
+  if (k >= 32 && k < 127) return (SDL_Keycode)k;
+  if (k >= 57399 && k <= 57408) return (k == 57399) ? SDLK_KP_0 : SDLK_KP_1 + (k - 57400);
+  switch (k) {
+  case 57412: return SDLK_KP_MINUS;
+  case 57413: return SDLK_KP_PLUS;
+  case 57414: return SDLK_KP_ENTER;
+  case 57441: return SDLK_LSHIFT;
+  case 57442: return SDLK_LCTRL;
+  case 57443: return SDLK_LALT;
+  case 57447: return SDLK_RSHIFT;
+  case 57448: return SDLK_RCTRL;
+  case 57449: return SDLK_RALT;
+  default: return SDLK_UNKNOWN;
+  }
+}
+
+// Ask the terminal whether it speaks the protocol. Terminals that do answer
+// the flags query before the DA1 reply; the others only answer DA1.
+static int kitty_detect(void) {
+  kitty_write(KITTY_QUERY);
+  CsiParser p = {0};
+  int supported = 0;
+  struct pollfd pfd = {.fd = STDIN_FILENO, .events = POLLIN};
+  while (poll(&pfd, 1, INPUT_KITTY_DETECT_MS) > 0) {
+    char buf[128];
+    ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+    if (n <= 0)
+      break;
+    for (ssize_t i = 0; i < n; i++) {
+      CsiSeq q;
+      if (!csi_feed(&p, buf[i], &q) || q.prefix != '?')
+        continue;
+      if (q.final == 'u')
+        supported = 1;
+      if (q.final == 'c')
+        return supported;
+    }
+  }
+  return 0;  // No DA1 reply: not a terminal we can drive
+}
+
+int input_kitty_thread(void *userdata) {
+  InputThread *in = (InputThread *)userdata;
+  if (!isatty(STDIN_FILENO) || !kitty_detect()) {
+    fprintf(stderr, "[input] terminal does not support the kitty keyboard protocol\n");
+    atomic_store(&in->state, -1);
+    return 1;
+  }
+
+  static int registered;
+  if (!registered) {
+    atexit(kitty_pop);
+    registered = 1;
+  }
+  kitty_write(KITTY_PUSH);
+  g_kitty_active = 1;
+  SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH);
+  atomic_store(&in->state, 1);
+
+  CsiParser p = {0};
+  struct pollfd pfd = {.fd = STDIN_FILENO, .events = POLLIN};
+  while (!atomic_load_explicit(&in->quit, memory_order_relaxed)) {
+    if (poll(&pfd, 1, INPUT_WAIT_MS) <= 0)
+      continue;
+    char buf[256];
+    ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+    if (n <= 0)
+      continue;
+    uint64_t now = input_now_ns();
+    for (ssize_t i = 0; i < n; i++) {
+      CsiSeq q;
+      if (!csi_feed(&p, buf[i], &q) || q.prefix)
+        continue;
+      SDL_Keycode key = kitty_to_sdl(&q);
+      if (key == SDLK_UNKNOWN || q.event == 2)  // Ignore autorepeat
+        continue;
+      input_push(in, q.event == 3 ? INPUT_KEY_UP : INPUT_KEY_DOWN, key, now);
+    }
+  }
+
+  kitty_pop();
+  return 0;
+}
@@ -0,0 +1,68 @@
+#include "judge.h"
+#include "config.h"
+#include <stdlib.h>
+
+// g_match[expected] has bit `held` set when that fret combination plays the
+// chord. 5 lanes give 32 x 32 combinations: 128 bytes, built once.
+static uint32_t g_match[32];
+
+void judge_init(void) {
+  for (int expected = 0; expected < 32; expected++) {
+    uint8_t anchor = chord_anchor_mask((uint8_t)expected);
+    uint32_t bits = 0;
+    for (int held = 0; held < 32; held++) {
+      if (expected && (held & ~anchor) == expected)
+        bits |= 1u << held;
+    }
+    g_match[expected] = bits;
+  }
+}
+
+int judge_match(const Chord *c, uint8_t held) {
+  return (int)((g_match[c->mask & 31] >> (held & 31)) & 1u);
+}
+
+Judgment judge_input(const Chord *c, uint8_t held, int64_t t_us, int strum) {
+  int64_t delta = c->t_us - t_us;
+  int64_t ad = llabs(delta);
+
+  if (ad > TIMING_BAD_US) {
+    if (!strum)
+      return JUDGE_NONE;
+    return delta > 0 ? JUDGE_EARLY : JUDGE_LATE;
+  }
+  if (!judge_match(c, held))
+    return strum ? JUDGE_WRONG : JUDGE_NONE;
+
+  if (ad <= TIMING_PERFECT_US)
+    return JUDGE_PERFECT;
+  if (ad <= TIMING_GOOD_US)
+    return JUDGE_GOOD;
+  return JUDGE_OK;
+}
+
+int judge_points(Judgment j) {
+  switch (j) {
+  case JUDGE_PERFECT:
+    return POINTS_PERFECT;
+  case JUDGE_GOOD:
+    return POINTS_GOOD;
+  case JUDGE_OK:
+    return POINTS_OK;
+  default:
+    return 0;
+  }
+}
+
+int judge_effect(Judgment j) {
+  switch (j) {
+  case JUDGE_PERFECT:
+    return EFFECT_TYPE_PERFECT;
+  case JUDGE_GOOD:
+    return EFFECT_TYPE_GOOD;
+  case JUDGE_OK:
+    return EFFECT_TYPE_OK;
+  default:
+    return EFFECT_TYPE_MISS;
+  }
+}
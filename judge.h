@@ -0,0 +1,32 @@
+#ifndef JUDGE_H
+#define JUDGE_H
+
+#include "midi.h"
+#include <stdint.h>
+
+typedef enum {
+  JUDGE_NONE,     // Nothing to judge (HOPO out of window or frets not matching)
+  JUDGE_EARLY,    // Strum before the window
+  JUDGE_LATE,     // Strum after the window
+  JUDGE_WRONG,    // Strum in the window with the wrong frets
+  JUDGE_OK,
+  JUDGE_GOOD,
+  JUDGE_PERFECT,
+} Judgment;
+
+// Build the (expected, held) match table; call once at startup.
+void judge_init(void);
+
+// 1 if `held` plays `c`, with anchoring.
+int judge_match(const Chord *c, uint8_t held);
+
+// Judge a strum (strum = 1) or a fret change on a HOPO (strum = 0) at song
+// time t_us (microseconds) against chord c.
+Judgment judge_input(const Chord *c, uint8_t held, int64_t t_us, int strum);
+
+static inline int judge_is_hit(Judgment j) { return j >= JUDGE_OK; }
+
+int judge_points(Judgment j);
+int judge_effect(Judgment j);
+
+#endif
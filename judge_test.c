@@ -0,0 +1,110 @@
+// Checks for the judgment engine: `make test`
+#include "judge.h"
+#include "config.h"
+#include <stdio.h>
+
+static int failures;
+
+#define CHECK(cond, ...)                             \
+  do {                                               \
+    if (!(cond)) {                                   \
+      fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+      fprintf(stderr, __VA_ARGS__);                  \
+      fputc('\n', stderr);                           \
+      failures++;                                    \
+    }                                                \
+  } while (0)
+
+// The matching rule main.c applied inline before the table: count the frets,
+// a single note accepts any lower frets, a chord must be held exactly.
+static int legacy_match(uint8_t expected, uint8_t held) {
+  int note_count = 0;
+  int highest_fret = -1;
+  for (int l = 0; l < 5; l++) {
+    if (expected & (1u << l)) {
+      note_count++;
+      highest_fret = l;
+    }
+  }
+  if (note_count == 1) {
+    int has_required = (held & (1u << highest_fret)) != 0;
+    int invalid_higher = 0;
+    for (int l = highest_fret + 1; l < 5; l++) {
+      if (held & (1u << l)) {
+        invalid_higher = 1;
+        break;
+      }
+    }
+    return has_required && !invalid_higher;
+  }
+  return held == expected;
+}
+
+static Chord chord_at(uint8_t mask, int64_t t_us) {
+  return (Chord){.t_us = t_us,
+                 .mask = mask,
+                 .note_count = (uint8_t)__builtin_popcount(mask),
+                 .anchor = chord_anchor_mask(mask)};
+}
+
+static void test_match_table(void) {
+  for (int expected = 0; expected < 32; expected++) {
+    Chord c = chord_at((uint8_t)expected, 0);
+    for (int held = 0; held < 32; held++) {
+      // An empty chord is never in a timeline; the table refuses it where the
+      // old code let an empty hand "play" it
+      int want = expected ? legacy_match((uint8_t)expected, (uint8_t)held) : 0;
+      CHECK(judge_match(&c, (uint8_t)held) == want,
+            "expected %02x held %02x: got %d, want %d", expected, held,
+            judge_match(&c, (uint8_t)held), want);
+    }
+  }
+}
+
+static void test_input(void) {
+  const int64_t t = 10000000;  // Chord at 10 s
+  Chord c = chord_at(0x05, t);  // Green + yellow
+  Chord single = chord_at(0x04, t);  // Yellow, anchorable
+
+  // Timing windows on a strum with the right frets
+  CHECK(judge_input(&c, 0x05, t, 1) == JUDGE_PERFECT, "on time");
+  CHECK(judge_input(&c, 0x05, t - TIMING_PERFECT_US, 1) == JUDGE_PERFECT, "perfect edge");
+  CHECK(judge_input(&c, 0x05, t + TIMING_PERFECT_US + 1, 1) == JUDGE_GOOD, "past perfect");
+  CHECK(judge_input(&c, 0x05, t - TIMING_GOOD_US, 1) == JUDGE_GOOD, "good edge");
+  CHECK(judge_input(&c, 0x05, t + TIMING_GOOD_US + 1, 1) == JUDGE_OK, "past good");
+  CHECK(judge_input(&c, 0x05, t - TIMING_BAD_US, 1) == JUDGE_OK, "window edge");
+
+  // Outside the window: a strum is early or late whatever the frets, a HOPO
+  // fret change is ignored
+  CHECK(judge_input(&c, 0x05, t - TIMING_BAD_US - 1, 1) == JUDGE_EARLY, "early");
+  CHECK(judge_input(&c, 0x00, t - TIMING_BAD_US - 1, 1) == JUDGE_EARLY, "early, no frets");
+  CHECK(judge_input(&c, 0x05, t + TIMING_BAD_US + 1, 1) == JUDGE_LATE, "late");
+  CHECK(judge_input(&c, 0x05, t - TIMING_BAD_US - 1, 0) == JUDGE_NONE, "HOPO early");
+  CHECK(judge_input(&c, 0x05, t + TIMING_BAD_US + 1, 0) == JUDGE_NONE, "HOPO late");
+
+  // In the window with the wrong frets
+  CHECK(judge_input(&c, 0x07, t, 1) == JUDGE_WRONG, "extra fret on a chord");
+  CHECK(judge_input(&c, 0x04, t, 1) == JUDGE_WRONG, "missing fret");
+  CHECK(judge_input(&c, 0x04, t, 0) == JUDGE_NONE, "HOPO, frets not there yet");
+
+  // Anchoring: lower frets under a single note, nothing above it
+  CHECK(judge_input(&single, 0x07, t, 1) == JUDGE_PERFECT, "anchored single");
+  CHECK(judge_input(&single, 0x07, t, 0) == JUDGE_PERFECT, "anchored HOPO");
+  CHECK(judge_input(&single, 0x0C, t, 1) == JUDGE_WRONG, "fret above a single");
+
+  CHECK(judge_is_hit(JUDGE_OK) && !judge_is_hit(JUDGE_WRONG), "judge_is_hit");
+  CHECK(judge_points(JUDGE_PERFECT) == POINTS_PERFECT && judge_points(JUDGE_LATE) == 0,
+        "judge_points");
+}
+
+int main(void) {
+  judge_init();
+  test_match_table();
+  test_input();
+  if (failures) {
+    fprintf(stderr, "judge_test: %d failed\n", failures);
+    return 1;
+  }
+  printf("judge_test: ok\n");
+  return 0;
+}
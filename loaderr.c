@@ -0,0 +1,41 @@
+#include "loaderr.h"
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+int load_fail(LoadError *err, LoadStatus status, const char *path,
+              size_t offset, const char *fmt, ...) {
+  int saved = errno;
+  if (!err)
+    return -1;
+  err->status = status;
+  err->sys_errno = (status == LOAD_ERR_IO) ? saved : 0;
+  err->offset = offset;
+  snprintf(err->path, sizeof(err->path), "%s", path ? path : "?");
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(err->msg, sizeof(err->msg), fmt, ap);
+  va_end(ap);
+  return -1;
+}
+
+void load_error_format(const LoadError *err, char *out, size_t size) {
+  if (size == 0)
+    return;
+  out[0] = '\0';
+  if (err->status == LOAD_OK)
+    return;
+  int n = snprintf(out, size, "%s: %s", err->path, err->msg);
+  if (n >= 0 && (size_t)n < size && err->sys_errno)
+    n += snprintf(out + n, size - (size_t)n, ": %s", strerror(err->sys_errno));
+  if (n >= 0 && (size_t)n < size && err->offset != LOAD_NO_OFFSET)
+    snprintf(out + n, size - (size_t)n, " (at byte %zu)", err->offset);
+}
+
+void load_error_print(const LoadError *err) {
+  char line[768];
+  load_error_format(err, line, sizeof(line));
+  if (line[0])
+    fprintf(stderr, "%s\n", line);
+}
@@ -0,0 +1,36 @@
+#ifndef LOADERR_H
+#define LOADERR_H
+
+#include <stddef.h>
+
+// Why a song file could not be loaded. Parsers and loaders fill one in and
+// return -1 instead of exiting, so one bad file never takes the game down.
+typedef enum {
+  LOAD_OK = 0,
+  LOAD_ERR_IO,      // open/stat/mmap/read failed; sys_errno has the cause
+  LOAD_ERR_FORMAT,  // Malformed or unsupported content
+  LOAD_ERR_NOMEM,
+} LoadStatus;
+
+#define LOAD_NO_OFFSET ((size_t)-1)
+
+typedef struct {
+  LoadStatus status;
+  int sys_errno;
+  size_t offset;  // Byte offset in the file, or LOAD_NO_OFFSET
+  char path[512];
+  char msg[128];
+} LoadError;
+
+// Records the failure in *err (which may be NULL) and returns -1, for
+// `return load_fail(...)`. For LOAD_ERR_IO the current errno is kept.
+int load_fail(LoadError *err, LoadStatus status, const char *path,
+              size_t offset, const char *fmt, ...)
+    __attribute__((format(printf, 5, 6)));
+
+// "path: message (at byte N)" into out, empty for LOAD_OK
+void load_error_format(const LoadError *err, char *out, size_t size);
+// The same on stderr
+void load_error_print(const LoadError *err);
+
+#endif
@@ -5,9 +5,14 @@
 #pragma GCC diagnostic ignored "-Wformat-truncation"
 
 #include "audio.h"
-#include "chart.h"
+#include "chartcache.h"
 #include "config.h"
+#include "evloop.h"
+#include "input.h"
+#include "judge.h"
+#include "loaderr.h"
 #include "midi.h"
+#include "pacer.h"
 #include "settings.h"
 #include "terminal.h"
 
@@ -45,6 +50,11 @@ typedef enum {
 	OPT_OFFSET,
 	OPT_LOOKAHEAD,
 	OPT_INVERTED,
+	OPT_FRAME_RATE,
+	OPT_PRECISE_PACING,
+	OPT_AUDIO_BUFFER,
+	OPT_REALTIME_AUDIO,
+	OPT_INPUT_BACKEND,
 	OPT_BACK,
 	OPT_COUNT
 } OptionItem;
@@ -74,7 +84,8 @@ static void draw_menu(MenuState menu, int selection, int waiting_for_key,
 		const char *key_names[] = {
 				"Green Fret",    "Red Fret", "Yellow Fret", "Blue Fret",
 				"Orange Fret",   "Strum",    "Offset (ms)", "Lookahead (sec)",
-				"Inverted Mode", "Back"};
+				"Inverted Mode", "Frame Rate",      "Precise Pacing", "Audio Buffer",
+				"Real-time Audio", "Input",         "Back"};
 
 		printf("\x1b[1;37m╔═══════════════════════════╗\x1b[0m\n");
 		printf("\x1b[1;37m║         OPTIONS           ║\x1b[0m\n");
@@ -93,6 +104,32 @@ static void draw_menu(MenuState menu, int selection, int waiting_for_key,
 			} else if (i == OPT_INVERTED) {
 				printf("%s%s: %s%s\n", prefix, key_names[i],
 							 settings->inverted_mode ? "ON" : "OFF", suffix);
+			} else if (i == OPT_FRAME_RATE) {
+				printf("%s%s: %d FPS%s\n", prefix, key_names[i], settings->target_fps,
+							 suffix);
+			} else if (i == OPT_PRECISE_PACING) {
+				printf("%s%s: %s%s\n", prefix, key_names[i],
+							 settings->precise_pacing ? "ON" : "OFF", suffix);
+			} else if (i == OPT_AUDIO_BUFFER) {
+				if (settings->audio_buffer_size == 0) {
+					printf("%s%s: Auto (%d)%s\n", prefix, key_names[i],
+								 settings->audio_buffer_tuned, suffix);
+				} else {
+					printf("%s%s: %d%s\n", prefix, key_names[i],
+								 settings->audio_buffer_size, suffix);
+				}
+			} else if (i == OPT_REALTIME_AUDIO) {
+				printf("%s%s: %s%s\n", prefix, key_names[i],
+							 settings->realtime_audio ? "ON" : "OFF", suffix);
+			} else if (i == OPT_INPUT_BACKEND) {
+				if (settings->input_backend == INPUT_BACKEND_EVDEV) {
+					printf("%s%s: %s (%s)%s\n", prefix, key_names[i],
+								 input_backend_name(settings->input_backend),
+								 settings->evdev_device, suffix);
+				} else {
+					printf("%s%s: %s%s\n", prefix, key_names[i],
+								 input_backend_name(settings->input_backend), suffix);
+				}
 			} else if (i == OPT_BACK) {
 				printf("\n%s%s%s\n", prefix, key_names[i], suffix);
 			} else {
@@ -134,6 +171,23 @@ static void draw_menu(MenuState menu, int selection, int waiting_for_key,
 						 "confirm\x1b[0m\n");
 		} else if (selection == OPT_INVERTED) {
 			printf("\n\x1b[90mPress Enter to toggle\x1b[0m\n");
+		} else if (selection == OPT_FRAME_RATE) {
+			printf("\n\x1b[90mUse +/- to change (F3 in-game shows the measured "
+						 "frame time against the budget)\x1b[0m\n");
+		} else if (selection == OPT_PRECISE_PACING) {
+			printf("\n\x1b[90mPress Enter to toggle (spins the last %dus of each "
+						 "frame for tighter frame times, at some CPU cost)\x1b[0m\n",
+						 PACER_SPIN_US);
+		} else if (selection == OPT_AUDIO_BUFFER) {
+			printf("\n\x1b[90mUse +/- to change frames per callback (Auto grows "
+						 "on underruns)\x1b[0m\n");
+		} else if (selection == OPT_REALTIME_AUDIO) {
+			printf("\n\x1b[90mPress Enter to toggle (locks audio in RAM, SCHED_FIFO "
+						 "callback; applies to the next song)\x1b[0m\n");
+		} else if (selection == OPT_INPUT_BACKEND) {
+			printf("\n\x1b[90mPress Enter to switch (evdev reads /dev/input, Terminal "
+						 "needs kitty keyboard support; both skip the window; applies "
+						 "to the next song)\x1b[0m\n");
 		} else if (selection < OPT_BACK) {
 			printf("\n\x1b[90mPress Enter to rebind key\x1b[0m\n");
 		} else {
@@ -143,6 +197,40 @@ static void draw_menu(MenuState menu, int selection, int waiting_for_key,
 	fflush(stdout);
 }
 
+// Cycle the audio buffer setting: Auto, then powers of two up to the max
+static void step_audio_buffer(Settings *settings, int dir) {
+	int size = settings->audio_buffer_size;
+	if (dir > 0) {
+		size = (size == 0) ? AUDIO_BUFFER_MIN : size * 2;
+		if (size > AUDIO_BUFFER_MAX)
+			size = AUDIO_BUFFER_MAX;
+	} else {
+		size = (size <= AUDIO_BUFFER_MIN) ? 0 : size / 2;
+	}
+	// Choosing Auto again tunes from scratch
+	if (size == 0 && settings->audio_buffer_size != 0)
+		settings->audio_buffer_tuned = AUDIO_BUFFER_MIN;
+	settings->audio_buffer_size = size;
+}
+
+// Step a frame rate through common display refresh rates
+static int step_fps(int fps, int dir) {
+	static const int rates[] = {30, 60, 120, 144, 165, 240};
+	const int count = (int)(sizeof(rates) / sizeof(rates[0]));
+	int i = 0;
+	while (i < count - 1 && rates[i] < fps)
+		i++;
+	if (dir > 0 && rates[i] <= fps && i < count - 1)
+		i++;
+	else if (dir < 0 && i > 0)
+		i--;
+	return rates[i];
+}
+
+static void step_target_fps(Settings *settings, int dir) {
+	settings->target_fps = step_fps(settings->target_fps, dir);
+}
+
 // Parse song.ini file for metadata
 static int parse_song_ini(const char *ini_path, char *title, char *artist,
 													char *year, int *diff_guitar, char *loading_phrase) {
@@ -278,6 +366,33 @@ static int parse_hopo_from_ini(const char *song_dir) {
 	return 170; // Default
 }
 
+// Load a song folder's notes.chart (preferred) or notes.mid with every chord
+// table built, from the compiled cache when it is up to date. On failure
+// *err says why.
+static int load_song_notes(const char *song_dir, CompiledChart *song,
+													 LoadError *err) {
+	char notes_path[4096];
+	int is_chart = 1;
+	snprintf(notes_path, sizeof(notes_path), "%s/notes.chart", song_dir);
+	if (access(notes_path, R_OK) != 0) {
+		is_chart = 0;
+		snprintf(notes_path, sizeof(notes_path), "%s/notes.mid", song_dir);
+		if (access(notes_path, R_OK) != 0)
+			return load_fail(err, LOAD_ERR_IO, song_dir, LOAD_NO_OFFSET,
+											 "no readable notes.chart or notes.mid");
+	}
+
+	if (chart_cache_load(notes_path, is_chart, parse_hopo_from_ini(song_dir),
+											 song, err) != 0)
+		return -1;
+	if (song->notes.n == 0) {
+		chart_cache_free(song);
+		return load_fail(err, LOAD_ERR_FORMAT, notes_path, LOAD_NO_OFFSET,
+										 "no notes found");
+	}
+	return 0;
+}
+
 // Scan Songs directory for valid songs
 static int scan_songs_directory(const char *songs_dir, SongEntry **out_songs) {
 	DIR *dir = opendir(songs_dir);
@@ -376,8 +491,10 @@ static int scan_songs_directory(const char *songs_dir, SongEntry **out_songs) {
 	return count;
 }
 
-// Display song selector and return selected index (-1 if quit)
-static int show_song_selector(SongEntry *songs, int count, Settings *settings) {
+// Display song selector and return selected index (-1 if quit). notice,
+// if not NULL, is shown in red under the song list.
+static int show_song_selector(SongEntry *songs, int count, Settings *settings,
+															const char *notice) {
 	// Use last selected song as default (clamped to valid range)
 	int selected = settings->last_song_index;
 	if (selected < 0 || selected >= count) {
@@ -476,6 +593,8 @@ static int show_song_selector(SongEntry *songs, int count, Settings *settings) {
 				printf("\x1b[1;"
 							 "36m╚═══════════════════════════════════════════════════════════"
 							 "════════════════════════════════╝\x1b[0m\n");
+				if (notice)
+					printf("\x1b[1;31mCould not load song: %s\x1b[0m\n", notice);
 
 				// Display album artwork using chafa
 				char album_path[4096];
@@ -613,6 +732,23 @@ static int show_song_selector(SongEntry *songs, int count, Settings *settings) {
 					// Offset adjusted with +/-
 				} else if (option_selection == OPT_LOOKAHEAD) {
 					// Lookahead adjusted with +/-
+				} else if (option_selection == OPT_FRAME_RATE) {
+					// Frame rate adjusted with +/-
+				} else if (option_selection == OPT_PRECISE_PACING) {
+					settings->precise_pacing = !settings->precise_pacing;
+					settings_save(settings);
+					need_redraw = 1;
+				} else if (option_selection == OPT_AUDIO_BUFFER) {
+					// Buffer size adjusted with +/-
+				} else if (option_selection == OPT_REALTIME_AUDIO) {
+					settings->realtime_audio = !settings->realtime_audio;
+					settings_save(settings);
+					need_redraw = 1;
+				} else if (option_selection == OPT_INPUT_BACKEND) {
+					settings->input_backend =
+							(settings->input_backend + 1) % INPUT_BACKEND_COUNT;
+					settings_save(settings);
+					need_redraw = 1;
 				} else {
 					waiting_for_key = 1;
 					need_redraw = 1;
@@ -637,6 +773,16 @@ static int show_song_selector(SongEntry *songs, int count, Settings *settings) {
 					settings->lookahead_sec = MIN_LOOKAHEAD;
 				settings_save(settings);
 				need_redraw = 1;
+			} else if ((c == '+' || c == '=' || c == '-') &&
+								 option_selection == OPT_FRAME_RATE) {
+				step_target_fps(settings, c == '-' ? -1 : 1);
+				settings_save(settings);
+				need_redraw = 1;
+			} else if ((c == '+' || c == '=' || c == '-') &&
+								 option_selection == OPT_AUDIO_BUFFER) {
+				step_audio_buffer(settings, c == '-' ? -1 : 1);
+				settings_save(settings);
+				need_redraw = 1;
 			}
 			continue;
 		}
@@ -896,23 +1042,212 @@ static int choose_best_diff_present(const NoteVec *notes) {
 	return best;
 }
 
-static int find_max_track(const NoteVec *notes) {
-	int max_track = 0;
-	for (size_t i = 0; i < notes->n; i++) {
-		if (notes->v[i].track > max_track)
-			max_track = notes->v[i].track;
+// Map an input event timestamp (CLOCK_MONOTONIC) onto the audio timeline,
+// so a press is judged when it happened rather than when the frame loop got
+// around to dequeuing it.
+static int64_t event_audio_time(const AudioEngine *aud, uint64_t t_ns) {
+	int64_t age_us = (int64_t)((input_now_ns() - t_ns) / 1000);
+	if (age_us > INPUT_MAX_AGE_US)
+		age_us = INPUT_MAX_AGE_US; // Stale or bogus timestamp
+	return audio_time_us(aud) - age_us;
+}
+
+// Render cost per frame, so a frame rate can be picked that the terminal
+// keeps up with
+typedef struct {
+	double draw_sum;
+	double draw_max;
+	long frames;
+	long over_budget; // Frames whose draw alone exceeded the frame period
+} FrameStats;
+
+static void frame_stats_add(FrameStats *fs, double draw_sec, double budget_sec) {
+	fs->draw_sum += draw_sec;
+	if (draw_sec > fs->draw_max)
+		fs->draw_max = draw_sec;
+	if (draw_sec > budget_sec)
+		fs->over_budget++;
+	fs->frames++;
+}
+
+static void format_frame_hud(const FrameStats *fs, const Pacer *pacer,
+														 char *out, size_t size) {
+	double avg = fs->frames ? fs->draw_sum / (double)fs->frames : 0.0;
+	PacerStats ps;
+	pacer_stats(pacer, &ps);
+	snprintf(out, size,
+					 "[frame] %d FPS budget %.2fms  draw avg/max=%.2f/%.2fms  over=%ld  "
+					 "late p50/p99/max=%.0f/%.0f/%.0fus  skipped=%llu  ",
+					 pacer->fps, 1000.0 / pacer->fps, avg * 1000.0,
+					 fs->draw_max * 1000.0, fs->over_budget, ps.late_p50_us,
+					 ps.late_p99_us, ps.late_max_us, (unsigned long long)ps.skipped);
+}
+
+// One-line audio callback summary for the debug HUD
+static void format_audio_hud(const AudioEngine *aud, char *out, size_t size) {
+	AudioStatsSnapshot snap;
+	audio_stats_snapshot(aud, &snap);
+	long minflt, majflt;
+	audio_page_faults(aud, &minflt, &majflt);
+	snprintf(out, size,
+					 "[audio] buf=%d (%.1fms)  cb=%llu  late=%llu  underruns=%llu  "
+					 "exec p50/p99/max=%.0f/%.0f/%.0fus  interval p99/max=%.0f/%.0fus  "
+					 "cb faults=%ld/%ld",
+					 aud->buffer_size, snap.period_us / 1000.0,
+					 (unsigned long long)snap.callbacks, (unsigned long long)snap.late,
+					 (unsigned long long)snap.underruns, snap.exec_p50_us,
+					 snap.exec_p99_us, snap.exec_max_us, snap.interval_p99_us,
+					 snap.interval_max_us, minflt, majflt);
+}
+
+// End-of-song audio timing report (printed under the results box)
+static void print_audio_report(const AudioEngine *aud) {
+	AudioStatsSnapshot snap;
+	audio_stats_snapshot(aud, &snap);
+	printf("  Audio: buffer %d frames (%.1f ms), %llu callbacks\n",
+				 aud->buffer_size, snap.period_us / 1000.0,
+				 (unsigned long long)snap.callbacks);
+	printf("    late callbacks: %llu   underruns: %llu\n",
+				 (unsigned long long)snap.late, (unsigned long long)snap.underruns);
+	printf("    callback time  p50 %.0fus  p99 %.0fus  max %.0fus\n",
+				 snap.exec_p50_us, snap.exec_p99_us, snap.exec_max_us);
+	printf("    interval       p50 %.0fus  p99 %.0fus  max %.0fus\n",
+				 snap.interval_p50_us, snap.interval_p99_us, snap.interval_max_us);
+	long minflt, majflt;
+	audio_page_faults(aud, &minflt, &majflt);
+	printf("    real-time: %s   callback page faults: %ld minor, %ld major\n",
+				 audio_rt_describe(aud), minflt, majflt);
+	printf("\n");
+}
+
+// Collect up to max .opus stems from a song folder (paths are malloc'd).
+// A path that cannot be allocated is left out like an unreadable stem.
+static int scan_opus_files(const char *song_path, char **opus_paths, int max) {
+	int opus_count = 0;
+	DIR *dir = opendir(song_path);
+	if (dir) {
+		struct dirent *entry;
+		while ((entry = readdir(dir)) != NULL) {
+			if (entry->d_name[0] == '.')
+				continue;
+
+			size_t len = strlen(entry->d_name);
+			if (len > 5 && strcmp(entry->d_name + len - 5, ".opus") == 0) {
+				if (opus_count < max) {
+					size_t size = strlen(song_path) + len + 2;
+					char *full_path = (char *)malloc(size);
+					if (!full_path) {
+						fprintf(stderr, "Out of memory listing %s\n", entry->d_name);
+						continue;
+					}
+					snprintf(full_path, size, "%s/%s", song_path, entry->d_name);
+					opus_paths[opus_count++] = full_path;
+				}
+			}
+		}
+		closedir(dir);
+	}
+	return opus_count;
+}
+
+// Headless mixdown: decode every stem of a song and run the mixer through
+// the offline backend as fast as possible, optionally writing a WAV.
+static int run_mixdown(const char *song_path, const char *wav_path,
+											 int buffer_size) {
+	char *opus_paths[MAX_OPUS_FILES];
+	int opus_count = scan_opus_files(song_path, opus_paths, MAX_OPUS_FILES);
+	if (opus_count == 0) {
+		fprintf(stderr, "No .opus files found in %s\n", song_path);
+		return 1;
+	}
+
+	AudioEngine aud;
+	audio_init_null(&aud, AUDIO_SAMPLE_RATE, buffer_size, AUDIO_BACKEND_OFFLINE);
+	aud.stems = (Stem *)calloc((size_t)opus_count, sizeof(Stem));
+	aud.stem_count = 0;
+	if (!aud.stems) {
+		fprintf(stderr, "Out of memory for %d stems\n", opus_count);
+		for (int i = 0; i < opus_count; i++)
+			free(opus_paths[i]);
+		return 1;
+	}
+	for (int i = 0; i < opus_count; i++) {
+		fprintf(stderr, "  [%d/%d] %s\n", i + 1, opus_count, opus_paths[i]);
+		LoadError err;
+		if (load_opus_file(opus_paths[i], &aud.stems[aud.stem_count], &err) != 0)
+			load_error_print(&err);
+		else
+			aud.stem_count++;
+	}
+	if (aud.stem_count == 0) {
+		fprintf(stderr, "No playable .opus files in %s\n", song_path);
+		free(aud.stems);
+		for (int i = 0; i < opus_count; i++)
+			free(opus_paths[i]);
+		return 1;
 	}
-	return max_track;
+
+	MixdownResult res;
+	int rc = audio_mixdown(&aud, wav_path, &res);
+	if (rc == 0) {
+		printf("Mixed %llu frames (%.1fs of audio) in %.3fs: %.1fx real time, "
+					 "buffer %d frames\n",
+					 (unsigned long long)res.frames,
+					 (double)res.frames / (double)aud.sample_rate, res.elapsed_sec,
+					 res.realtime_factor, aud.buffer_size);
+		if (wav_path)
+			printf("Wrote %s\n", wav_path);
+	}
+
+	audio_close(&aud);
+	for (int i = 0; i < aud.stem_count; i++)
+		free(aud.stems[i].pcm);
+	free(aud.stems);
+	for (int i = 0; i < opus_count; i++)
+		free(opus_paths[i]);
+	return rc == 0 ? 0 : 1;
+}
+
+static void print_usage(const char *prog) {
+	fprintf(stderr,
+					"Usage: %s [--null-audio]\n"
+					"       %s --mixdown <song_dir> [out.wav]\n"
+					"  --null-audio  play without a sound card (silent, real-time clock)\n"
+					"  --mixdown     mix a song's stems offline as fast as possible\n",
+					prog, prog);
 }
 
 // Scan for songs function starts on next line
 int main(int argc, char **argv) {
-	(void)argc; // Unused
-	(void)argv; // Unused
-
 	Settings settings;
 	settings_load(&settings);
 
+	int null_audio = 0;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--null-audio") == 0) {
+			null_audio = 1;
+		} else if (strcmp(argv[i], "--mixdown") == 0 && i + 1 < argc) {
+			int buffer_size = settings.audio_buffer_size
+														? settings.audio_buffer_size
+														: settings.audio_buffer_tuned;
+			return run_mixdown(argv[i + 1], i + 2 < argc ? argv[i + 2] : NULL,
+												 buffer_size);
+		} else {
+			print_usage(argv[0]);
+			return 1;
+		}
+	}
+
+	judge_init();
+
+	// Registered once, ahead of the first term_raw_on() (the kitty probe), so
+	// every exit path below leaves the shell usable
+	atexit(show_cursor);
+	atexit(term_raw_off);
+
+	// Why the last chosen song could not be loaded, shown in the selector
+	static char load_notice[768];
+
 select_song:
 	// Always use song selector
 	SongEntry *songs = NULL;
@@ -925,59 +1260,28 @@ select_song:
 		return 1;
 	}
 
-	int selected = show_song_selector(songs, song_count, &settings);
+	int selected = show_song_selector(songs, song_count, &settings,
+																		load_notice[0] ? load_notice : NULL);
+	load_notice[0] = '\0';
 
 	if (selected < 0) {
 		free(songs);
 		return 0; // User quit
 	}
 
-	// Parse notes file early to check available difficulties
-	char notes_path[4096];
-	int is_chart = 0;
-
-	// Check for notes.chart first, then notes.mid
-	snprintf(notes_path, sizeof(notes_path), "%s/notes.chart",
-					 songs[selected].path);
-	if (access(notes_path, R_OK) == 0) {
-		is_chart = 1;
-	} else {
-		snprintf(notes_path, sizeof(notes_path), "%s/notes.mid",
-						 songs[selected].path);
-		if (access(notes_path, R_OK) != 0) {
-			fprintf(stderr, "No notes.mid or notes.chart file found in %s\n",
-							songs[selected].path);
-			free(songs);
-			return 1;
-		}
-	}
-
-	NoteVec notes = {0};
-	TrackNameVec track_names = {0};
-
-	if (is_chart) {
-		fprintf(stderr, "Parsing .chart file: %s\n", notes_path);
-		if (chart_parse(notes_path, &notes, &track_names) != 0) {
-			fprintf(stderr, "Failed to parse .chart file\n");
-			free(songs);
-			return 1;
-		}
-	} else {
-		fprintf(stderr, "Parsing MIDI: %s\n", notes_path);
-		midi_parse(notes_path, &notes, &track_names);
-	}
-
-	if (notes.n == 0) {
-		fprintf(stderr, "No notes found in notes file.\n");
-		free(notes.v);
-		free(track_names.v);
+	// Parse notes file early to check available difficulties. A song whose
+	// notes cannot be loaded goes back to the selector with the reason.
+	CompiledChart song;
+	LoadError load_err;
+	if (load_song_notes(songs[selected].path, &song, &load_err) != 0) {
+		load_error_format(&load_err, load_notice, sizeof(load_notice));
 		free(songs);
-		return 1;
+		goto select_song;
 	}
 
 	// Check which difficulties are available
 	int available_diffs[4] = {0};
-	check_available_difficulties(&notes, available_diffs);
+	check_available_difficulties(&song.notes, available_diffs);
 
 	// Show difficulty selector (loop back if user presses ESC)
 	int diff_choice;
@@ -986,8 +1290,7 @@ select_song:
 
 		if (diff_choice == -2) {
 			// User pressed Q - quit app
-			free(notes.v);
-			free(track_names.v);
+			chart_cache_free(&song);
 			free(songs);
 			return 0;
 		}
@@ -995,58 +1298,23 @@ select_song:
 		if (diff_choice == -1) {
 			// User pressed ESC - go back to song selector
 			// Clean up current notes
-			free(notes.v);
-			free(track_names.v);
-			notes.v = NULL;
-			notes.n = notes.cap = 0;
-			track_names.v = NULL;
-			track_names.n = track_names.cap = 0;
-
-			selected = show_song_selector(songs, song_count, &settings);
+			chart_cache_free(&song);
+
+			selected = show_song_selector(songs, song_count, &settings, NULL);
 			if (selected < 0) {
 				free(songs);
 				return 0; // User quit from song selector
 			}
 
 			// Re-parse notes for new song
-			snprintf(notes_path, sizeof(notes_path), "%s/notes.chart",
-							 songs[selected].path);
-			if (access(notes_path, R_OK) == 0) {
-				is_chart = 1;
-			} else {
-				snprintf(notes_path, sizeof(notes_path), "%s/notes.mid",
-								 songs[selected].path);
-				if (access(notes_path, R_OK) != 0) {
-					fprintf(stderr, "No notes.mid or notes.chart file found in %s\n",
-									songs[selected].path);
-					free(songs);
-					return 1;
-				}
-				is_chart = 0;
-			}
-
-			if (is_chart) {
-				fprintf(stderr, "Parsing .chart file: %s\n", notes_path);
-				if (chart_parse(notes_path, &notes, &track_names) != 0) {
-					fprintf(stderr, "Failed to parse .chart file\n");
-					free(songs);
-					return 1;
-				}
-			} else {
-				fprintf(stderr, "Parsing MIDI: %s\n", notes_path);
-				midi_parse(notes_path, &notes, &track_names);
-			}
-
-			if (notes.n == 0) {
-				fprintf(stderr, "No notes found in notes file.\n");
-				free(notes.v);
-				free(track_names.v);
+			if (load_song_notes(songs[selected].path, &song, &load_err) != 0) {
+				load_error_format(&load_err, load_notice, sizeof(load_notice));
 				free(songs);
-				return 1;
+				goto select_song;
 			}
 
 			// Re-check available difficulties
-			check_available_difficulties(&notes, available_diffs);
+			check_available_difficulties(&song.notes, available_diffs);
 			continue; // Try difficulty selection again
 		}
 		break; // Valid difficulty selected
@@ -1068,12 +1336,30 @@ select_song:
 
 	// Prefer WSLg backends: Wayland video, PulseAudio audio
 	//   SDL_setenv("SDL_VIDEODRIVER", SDL_VIDEO_DRIVER, 1);
-	SDL_setenv("SDL_AUDIODRIVER", "pulse", 1);
-
-	if (SDL_Init(SDL_INIT_AUDIO | SDL_INIT_VIDEO | SDL_INIT_EVENTS) != 0) {
-		fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
-		fprintf(stderr, "Make sure WSLg is enabled (wsl --update)\n");
+	if (!null_audio)
+		SDL_setenv("SDL_AUDIODRIVER", "pulse", 1);
+
+	// SIGINT/SIGTERM/SIGWINCH are read from the event loop's signalfd; the mask
+	// is set before SDL and the input thread start so their threads inherit it
+	static EventLoop loop = {.epfd = -1, .wake_fd = -1, .signal_fd = -1,
+													 .tick_fd = -1};
+	if (evloop_init(&loop) != 0)
 		return 1;
+
+	// Video, when the SDL window backend needs it, is initialized on the
+	// input thread that owns the window
+	Uint32 sdl_flags = SDL_INIT_EVENTS;
+	if (!null_audio)
+		sdl_flags |= SDL_INIT_AUDIO;
+	if (SDL_Init(sdl_flags) != 0 && !null_audio) {
+		// No audio driver: keep going on the null backend
+		fprintf(stderr, "SDL_Init with audio failed: %s\n", SDL_GetError());
+		null_audio = 1;
+		sdl_flags &= ~SDL_INIT_AUDIO;
+		if (SDL_Init(sdl_flags) != 0) {
+			fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
+			return 1;
+		}
 	}
 	atexit(SDL_Quit);
 
@@ -1084,59 +1370,31 @@ select_song:
 		printf("No audio driver initialized\n");
 	}
 
-	fprintf(stderr, "Creating SDL window for input...\n");
-
-	SDL_Window *window =
-			SDL_CreateWindow(SDL_WINDOW_TITLE, 0, 0, // Top-left corner
-											 SDL_WINDOW_WIDTH, SDL_WINDOW_HEIGHT,
-											 SDL_WINDOW_SHOWN | SDL_WINDOW_INPUT_FOCUS);
-
-	if (!window) {
-		fprintf(stderr, "SDL_CreateWindow failed: %s\n", SDL_GetError());
-		fprintf(stderr, "Check that WSLg is working: wsl --update\n");
-		return 1;
-	}
-
-	SDL_Renderer *renderer =
-			SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE);
-	if (renderer) {
-		SDL_SetRenderDrawColor(renderer, 30, 30, 30, 255);
-		SDL_RenderClear(renderer);
-		SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255);
-		SDL_Rect r = {10, 10, 380, 130};
-		SDL_RenderDrawRect(renderer, &r);
-
-		SDL_Color white = {255, 255, 255, 255};
-		(void)white;
-		SDL_RenderPresent(renderer);
+	// Window (or evdev fds) and event pump live on the input thread
+	static InputThread input;
+	static Pacer pacer = {.fd = -1};
+	InputBackend input_backend = (InputBackend)settings.input_backend;
+	if (input_backend == INPUT_BACKEND_SDL)
+		fprintf(stderr, "Creating SDL window for input...\n");
+	if (input_backend == INPUT_BACKEND_KITTY)
+		term_raw_on(); // The terminal's reply to the protocol query comes on stdin
+	if (input_start(&input, input_backend, settings.evdev_device,
+									loop.wake_fd) != 0) {
+		if (input_backend == INPUT_BACKEND_SDL)
+			return 1;
+		fprintf(stderr, "Falling back to SDL window input\n");
+		input_backend = INPUT_BACKEND_SDL;
+		if (input_start(&input, input_backend, NULL, loop.wake_fd) != 0)
+			return 1;
 	}
+	// Kitty input reads stdin on its own thread; otherwise stray terminal
+	// bytes are discarded as they arrive
+	if (input_backend != INPUT_BACKEND_KITTY)
+		evloop_watch_stdin(&loop, 1);
 
 	// Load song files from selected folder (opus files)
-	char *opus_paths[16];
-	int opus_count = 0;
-
-	// Scan for opus files
-	DIR *dir = opendir(song_path);
-	if (dir) {
-		struct dirent *entry;
-		while ((entry = readdir(dir)) != NULL) {
-			if (entry->d_name[0] == '.')
-				continue;
-
-			size_t len = strlen(entry->d_name);
-			if (len > 5 && strcmp(entry->d_name + len - 5, ".opus") == 0) {
-				if (opus_count < 16) {
-					char *full_path =
-							(char *)malloc(strlen(song_path) + strlen(entry->d_name) + 2);
-					sprintf(full_path, "%s/%s", song_path, entry->d_name);
-					opus_paths[opus_count++] = full_path;
-				}
-			}
-		}
-		closedir(dir);
-	}
-
-	int hopo_frequency = parse_hopo_from_ini(song_path);
+	char *opus_paths[MAX_OPUS_FILES];
+	int opus_count = scan_opus_files(song_path, opus_paths, MAX_OPUS_FILES);
 
 	// Display loading phrase if available in cyan
 	if (loading_phrase[0] != '\0') {
@@ -1147,23 +1405,25 @@ select_song:
 
 	int diff = parse_diff(diff_str);
 	if (diff < 0) {
-		diff = choose_best_diff_present(&notes);
+		diff = choose_best_diff_present(&song.notes);
 		if (diff < 0) {
 			fprintf(stderr, "No valid difficulty in MIDI\n");
+			input_stop(&input);
 			return 1;
 		}
 		fprintf(stderr, "Auto-selected difficulty: %s\n", diff_name(diff));
 	}
 
-	int max_track = find_max_track(&notes);
+	int max_track = song.max_track;
 
 	// Try to find "PART GUITAR" track as default
 	int selected_track = -1;
-	for (size_t i = 0; i < track_names.n; i++) {
-		if (strstr(track_names.v[i].name, "PART GUITAR") != NULL) {
-			selected_track = track_names.v[i].track_num;
+	for (size_t i = 0; i < song.track_names.n; i++) {
+		if (strstr(song.track_names.v[i].name, "PART GUITAR") != NULL &&
+				song.track_names.v[i].track_num <= max_track) {
+			selected_track = song.track_names.v[i].track_num;
 			fprintf(stderr, "Auto-selected track: %s (track %d)\n",
-							track_names.v[i].name, selected_track);
+							song.track_names.v[i].name, selected_track);
 			break;
 		}
 	}
@@ -1173,74 +1433,112 @@ select_song:
 		fprintf(stderr, "PART GUITAR not found, using all tracks\n");
 	}
 
-	ChordVec chords = {0};
-	build_chords(&notes, diff, selected_track, hopo_frequency, &chords);
+	// Points into the compiled chart's tables; switching part or difficulty
+	// mid-song is a pointer swap
+	const ChordVec *chords = chart_cache_chords(&song, diff, selected_track);
 
-	if (chords.n == 0) {
+	if (chords->n == 0) {
 		fprintf(stderr, "No notes for difficulty %s\n", diff_name(diff));
+		input_stop(&input);
 		return 1;
 	}
 
-	fprintf(stderr, "Found %zu chords for difficulty %s\n", chords.n,
+	fprintf(stderr, "Found %zu chords for difficulty %s\n", chords->n,
 					diff_name(diff));
 
 	AudioEngine aud = {0};
-	audio_init(&aud, AUDIO_SAMPLE_RATE);
+	int autotune = (settings.audio_buffer_size == 0);
+	int buffer_size =
+			autotune ? audio_autotune_start(settings.audio_buffer_tuned)
+							 : settings.audio_buffer_size;
+	if (null_audio)
+		audio_init_null(&aud, AUDIO_SAMPLE_RATE, buffer_size, AUDIO_BACKEND_NULL);
+	else
+		audio_init(&aud, AUDIO_SAMPLE_RATE, buffer_size, autotune);
 
 	fprintf(stderr, "Loading %d Opus files...\n", opus_count);
 	aud.stems = (Stem *)calloc((size_t)opus_count, sizeof(Stem));
-	aud.stem_count = opus_count;
+	aud.stem_count = 0;
+	if (opus_count > 0 && !aud.stems) {
+		// Back to the selector, like a song whose notes failed to load
+		snprintf(load_notice, sizeof(load_notice),
+						 "%s: out of memory for %d audio stems", song_path, opus_count);
+		audio_close(&aud);
+		input_stop(&input);
+		evloop_close(&loop);
+		chart_cache_free(&song);
+		for (int i = 0; i < opus_count; i++)
+			free(opus_paths[i]);
+		show_cursor();
+		term_raw_off();
+		goto select_song;
+	}
 
+	// A stem that fails to decode is left out; the song plays without it
 	int guitar_stem_idx = -1;
 	for (int i = 0; i < opus_count; i++) {
 		fprintf(stderr, "  [%d/%d] %s\n", i + 1, opus_count, opus_paths[i]);
-		load_opus_file(opus_paths[i], &aud.stems[i]);
-		aud.stems[i].gain = 1.0f;
-		aud.stems[i].target_gain = 1.0f;
-		aud.stems[i].enabled = 1;
+		Stem *stem = &aud.stems[aud.stem_count];
+		LoadError err;
+		if (load_opus_file(opus_paths[i], stem, &err) != 0) {
+			load_error_print(&err);
+			continue;
+		}
+		stem->gain = 1.0f;
+		stem->target_gain = 1.0f;
+		stem->enabled = 1;
 
 		// Check if this is the guitar track
-		if (strstr(aud.stems[i].name, "guitar") != NULL ||
-				strstr(aud.stems[i].name, "Guitar") != NULL ||
-				strstr(aud.stems[i].name, "GUITAR") != NULL) {
-			aud.stems[i].is_player_track = 1;
-			guitar_stem_idx = i;
+		if (strstr(stem->name, "guitar") != NULL ||
+				strstr(stem->name, "Guitar") != NULL ||
+				strstr(stem->name, "GUITAR") != NULL) {
+			stem->is_player_track = 1;
+			guitar_stem_idx = aud.stem_count;
 			fprintf(stderr, "  -> Detected as player track (dynamic volume)\n");
 		}
+		aud.stem_count++;
 	}
 
+	if (settings.realtime_audio)
+		audio_enable_realtime(&aud);
+
 	fprintf(stderr,
 					"\nPress \x1b[0;96mENTER\x1b[0m to start, or Q/ESC to quit.\n");
-	fprintf(stderr, "\x1b[0;93mFocus the SDL window if needed.\x1b[0m\n");
+	if (input_backend == INPUT_BACKEND_SDL)
+		fprintf(stderr, "\x1b[0;93mFocus the SDL window if needed.\x1b[0m\n");
 
 	term_raw_on();
 	clear_screen_hide_cursor();
-	atexit(show_cursor);
-	atexit(term_raw_off);
 
-	// Idle loop before game start; keep minimal work
+	// Idle loop before game start: sleeps in the event loop until input or a
+	// signal arrives
+	input_raise(&input);
 	while (1) {
-		SDL_Event e;
-		while (SDL_PollEvent(&e)) {
-			if (e.type == SDL_QUIT)
+		InputEvent e;
+		while (input_poll(&input, &e)) {
+			if (e.type == INPUT_QUIT)
 				goto cleanup;
-			if (e.type == SDL_KEYDOWN && e.key.repeat == 0) {
-				if (e.key.keysym.sym == KEY_MENU || e.key.keysym.sym == KEY_QUIT)
+			if (e.type == INPUT_FOCUS_LOST)
+				input_raise(&input);
+			if (e.type == INPUT_KEY_DOWN) {
+				if (e.key == KEY_PAUSE_MENU || e.key == KEY_QUIT)
 					goto cleanup;
-				if (e.key.keysym.sym == KEY_START || e.key.keysym.sym == KEY_START2)
+				if (e.key == KEY_START || e.key == KEY_START2)
 					goto start_game;
 			}
 		}
 
-		if (window && (SDL_GetWindowFlags(window) & SDL_WINDOW_INPUT_FOCUS) == 0) {
-			SDL_RaiseWindow(window);
-		}
-
-		SDL_Delay(10);
+		int ready = evloop_wait(&loop, -1);
+		if (ready & LOOP_INTERRUPT)
+			goto cleanup;
+		if (ready & LOOP_STDIN)
+			tcflush(STDIN_FILENO, TCIFLUSH);
 	}
 
 start_game:
 	audio_reset(&aud);
+	audio_stats_reset(&aud);
+	set_hud_line(NULL);
 	audio_start(&aud);
 	aud.started = 1;
 	fprintf(stderr, "[audio] started\n");
@@ -1251,9 +1549,6 @@ start_game:
 	double total_offset_ms = global_offset_ms + song_offset_ms;
 
 	double lookahead = settings.lookahead_sec;
-	const double perfect = TIMING_PERFECT;
-	const double good = TIMING_GOOD;
-	const double bad = TIMING_BAD;
 
 	uint8_t held = 0;
 	Stats st = {0};
@@ -1268,17 +1563,41 @@ start_game:
 	double feedback_timer = 0.0;
 
 	size_t cursor = 0;
-	size_t sustain_cursor = 0;   // Track which notes have sustains being held
 	uint8_t active_sustains = 0; // Bitmask of lanes with active sustains
 
 	// Celebration effects when at max multiplier
 	int was_at_max_multiplier = 0;
-	double next_celebration_time = 0.0;
+	int prev_multiplier = 1;
+	int show_audio_stats = 0;
+	int64_t next_celebration_us = 0;
 	double celebration_cooldown = 0.0;
 
-	const double fps = TARGET_FPS;
-	const double dt = 1.0 / fps;
-	double next = now_sec();
+	// Session frame rate; starts at the setting and drops on overload
+	int frame_fps = settings.target_fps;
+	double dt = 1.0 / frame_fps;
+	pacer_close(&pacer);
+	if (pacer_init(&pacer, frame_fps, settings.precise_pacing) != 0)
+		goto cleanup;
+	evloop_set_tick(&loop, pacer.fd);
+	FrameStats frame_stats = {0};
+
+	const double sim_dt = 1.0 / SIM_HZ;
+	double sim_acc = 0.0;
+	double sim_last = now_sec();
+
+	// Menus redraw only on input, so the frame tick is detached while paused
+	// and the loop sleeps until a key arrives
+	auto void pause_frames() {
+		evloop_set_tick(&loop, -1);
+	}
+
+	// Back to play: a fresh deadline grid from now, and the pause is not
+	// counted as a stall by the simulation
+	auto void resume_frames() {
+		pacer_set_fps(&pacer, frame_fps);
+		evloop_set_tick(&loop, pacer.fd);
+		sim_last = now_sec();
+	}
 
 	// Helper to update guitar volume based on consecutive misses
 	auto void update_guitar_volume() {
@@ -1295,23 +1614,239 @@ start_game:
 		aud.stems[guitar_stem_idx].target_gain = target;
 	}
 
+	// Score a strum (strum = 1) or a HOPO fret change (strum = 0) at song time t
+	auto void judge_event(int strum, int64_t t_us) {
+		if (cursor >= chords->n)
+			return; // Notes that passed are already marked as missed in the main loop
+
+		const Chord c = cv_get(chords, cursor);
+		Judgment j = judge_input(&c, held, t_us, strum);
+
+		if (judge_is_hit(j)) {
+			st.hit++;
+			st.streak++;
+			consecutive_misses = 0; // Reset on hit
+			update_guitar_volume();
+			st.score += judge_points(j) * (1 + st.streak / STREAK_DIVISOR);
+
+			for (int l = 0; l < 5; l++) {
+				if (c.mask & (1u << l)) {
+					add_effect(l, judge_effect(j), EFFECT_DURATION_HIT);
+				}
+			}
+			cursor++;
+		} else if (j == JUDGE_WRONG) {
+			// Miss - show effects on wrong frets (anchored lower frets are fine)
+			uint8_t wrong = (uint8_t)((held & ~c.anchor) ^ c.mask);
+			for (int l = 0; l < 5; l++) {
+				if (wrong & (1u << l)) {
+					add_effect(l, EFFECT_TYPE_MISS, EFFECT_DURATION_MISS);
+				}
+			}
+			st.miss++;
+			st.streak = 0;
+			consecutive_misses++;
+			update_guitar_volume();
+			audio_sfx_play(&aud, SFX_MISS, SFX_GAIN);
+
+			snprintf(timing_feedback, sizeof(timing_feedback), "WRONG FRETS");
+			feedback_timer = 0.5; // Show for 0.5 seconds
+		} else if (j == JUDGE_EARLY || j == JUDGE_LATE) {
+			snprintf(timing_feedback, sizeof(timing_feedback), "%s",
+							 j == JUDGE_EARLY ? "TOO EARLY" : "TOO LATE");
+			feedback_timer = 0.5;
+		}
+	}
+
+	// Swap in another part or difficulty at song time t_us. The cursor is
+	// re-seated at the first chord still inside the hit window, so play
+	// carries on from the same spot with the score kept.
+	auto int switch_chords(int new_diff, int new_track, int64_t t_us) {
+		const ChordVec *next = chart_cache_chords(&song, new_diff, new_track);
+		if (next->n == 0)
+			return 0;
+		chords = next;
+		diff = new_diff;
+		selected_track = new_track;
+		cursor = cv_seek(chords, t_us - TIMING_BAD_US);
+		return 1;
+	}
+
+	// One fixed simulation step at song time ts (microseconds)
+	auto void sim_step(int64_t ts) {
+		// Skip game logic if in menu
+		if (menu_state == MENU_NONE) {
+			// Check for missed notes (notes that passed without being hit)
+			while (cursor < chords->n && chords->t_us[cursor] < ts - TIMING_BAD_US) {
+				uint8_t m = chords->mask[cursor];
+				for (int l = 0; l < 5; l++) {
+					if (m & (1u << l)) {
+						add_effect(l, EFFECT_TYPE_MISS, EFFECT_DURATION_MISS);
+					}
+				}
+				// Only clunk when a streak breaks, not for every note of a skipped run
+				if (st.streak > 0)
+					audio_sfx_play(&aud, SFX_MISS, SFX_GAIN);
+				st.miss++;
+				st.streak = 0;
+				consecutive_misses++;
+				update_guitar_volume();
+				cursor++;
+			}
+		}
+
+		update_effects(sim_dt);
+		update_multiline_effects(sim_dt);
+
+		// Track active sustains - check if currently held notes have sustains
+		active_sustains = 0;
+		if (menu_state == MENU_NONE) {
+			// Chords sounding at ts, from the interval index
+			for (size_t i = cv_first_active(chords, ts);
+					 i < chords->n && chords->t_us[i] <= ts; i++) {
+				int64_t note_time = chords->t_us[i];
+				int64_t note_end = chords->end_us[i];
+
+				// Check if this note's sustain is currently active
+				if (ts <= note_end && note_end - note_time > 100000) {
+					// Check if the player is holding the correct frets
+					uint8_t note_mask = chords->mask[i];
+					if ((held & note_mask) == note_mask) {
+						active_sustains |= note_mask;
+					}
+				}
+			}
+		}
+		set_sustain_flames(active_sustains);
+
+		// Celebration effects - start at half bar, intensify as bar fills
+		if (menu_state == MENU_NONE) {
+			int max_streak_for_max_mult = (MAX_MULTIPLIER - 1) * STREAK_DIVISOR;
+			int half_streak = max_streak_for_max_mult / 2;
+			int celebration_active = (st.streak >= half_streak);
+
+			int multiplier = 1 + st.streak / STREAK_DIVISOR;
+			if (multiplier > MAX_MULTIPLIER)
+				multiplier = MAX_MULTIPLIER;
+			if (multiplier == MAX_MULTIPLIER && prev_multiplier < MAX_MULTIPLIER)
+				audio_sfx_play(&aud, SFX_STAR_POWER, SFX_GAIN);
+			prev_multiplier = multiplier;
+
+			// Just reached half bar - initialize celebration timer
+			if (celebration_active && !was_at_max_multiplier) {
+				// Calculate initial cooldown based on current streak position
+				double progress = (double)(st.streak - half_streak) /
+													(double)(max_streak_for_max_mult - half_streak);
+				if (progress > 1.0)
+					progress = 1.0;
+
+				// Cooldown scales from 2.0s (at half) to 0.3s (at max): 2.0 - (progress
+				// * 1.7)
+				double base_cooldown = 2.0 - (progress * 1.7);
+				// Add small random variance (±10%)
+				celebration_cooldown =
+						base_cooldown * (0.9 + ((double)rand() / RAND_MAX) * 0.2);
+				next_celebration_us = ts + (int64_t)(celebration_cooldown * 1e6);
+			}
+
+			// Spawn celebration effects periodically while above half bar
+			if (celebration_active && ts >= next_celebration_us) {
+				// Get terminal size for safe spawn zones
+				int rows, cols;
+				get_term_size(&rows, &cols);
+
+				const int lanes = 5;
+				const int lane_w = NOTE_WIDTH;
+				int grid_w = lanes * lane_w;
+				int x0 = (cols - grid_w) / 2;
+				int top_y = 3;
+				int hit_y = top_y + (rows - 3 - 10 < 10 ? 10 : rows - 3);
+
+				// Define safe zones (avoid lanes and permanent UI)
+				int left_zone_x = 5;                 // Left of streak bar
+				int right_zone_x = x0 + grid_w + 15; // Right of lanes
+				int safe_y_min = top_y;
+				int safe_y_max = hit_y - 5;
+
+				// Random effect type: 100 (explosion) or 101 (sparkle)
+				int effect_type = (rand() % 2) + 100;
+
+				// Random position in safe zones
+				int use_right_zone = rand() % 2; // 50% chance left or right
+				int spawn_x, spawn_y;
+
+				if (use_right_zone && right_zone_x + 5 < cols) {
+					// Right zone (after lanes)
+					spawn_x = right_zone_x + (rand() % (cols - right_zone_x - 5));
+				} else if (left_zone_x + 5 < x0) {
+					// Left zone (before lanes but after streak bar)
+					spawn_x = left_zone_x + (rand() % (x0 - left_zone_x - 5));
+				} else {
+					// Fallback: just use a safe spot
+					spawn_x = cols / 4;
+				}
+
+				spawn_y = safe_y_min + (rand() % (safe_y_max - safe_y_min + 1));
+
+				// Spawn the effect
+				add_multiline_effect(spawn_x, spawn_y, effect_type, 0.5, 5, 3);
+
+				// Calculate next cooldown based on current streak position
+				double progress = (double)(st.streak - half_streak) /
+													(double)(max_streak_for_max_mult - half_streak);
+				if (progress > 1.0)
+					progress = 1.0;
+
+				// Cooldown scales from 2.0s (at half) to 0.3s (at max): 2.0 - (progress
+				// * 1.7)
+				double base_cooldown = 2.0 - (progress * 1.7);
+				// Add small random variance (±10%)
+				celebration_cooldown =
+						base_cooldown * (0.9 + ((double)rand() / RAND_MAX) * 0.2);
+				next_celebration_us = ts + (int64_t)(celebration_cooldown * 1e6);
+			}
+
+			was_at_max_multiplier = celebration_active;
+		}
+
+		// Update timing feedback timer
+		if (feedback_timer > 0) {
+			feedback_timer -= sim_dt;
+			if (feedback_timer <= 0) {
+				timing_feedback[0] = '\0';
+			}
+		}
+	}
+
 	while (1) {
+		// Sleep until the frame tick; input wakes the loop early so menus
+		// respond at once, but frames are only drawn on ticks
+		int ready = evloop_wait(&loop, -1);
+		if (ready & LOOP_INTERRUPT)
+			goto cleanup;
+		if (ready & LOOP_STDIN)
+			tcflush(STDIN_FILENO, TCIFLUSH);
+		if (ready & LOOP_RESIZE) {
+			clear_screen_hide_cursor();
+			if (menu_state != MENU_NONE)
+				draw_menu(menu_state, menu_selection, waiting_for_key, &settings);
+		}
 
-		SDL_Event e;
-		while (SDL_PollEvent(&e)) {
+		// Events carry the time the input thread saw them, so handling them
+		// between frames does not move the judgment
+		InputEvent e;
+		while (input_poll(&input, &e)) {
 			uint8_t old_held = held;
+			int64_t t_event = event_audio_time(&aud, e.t_ns) + llround(total_offset_ms * 1000.0);
 
-			if (e.type == SDL_QUIT)
+			if (e.type == INPUT_QUIT)
 				goto cleanup;
 
-			if (e.type == SDL_WINDOWEVENT) {
-				if (e.window.event == SDL_WINDOWEVENT_FOCUS_LOST) {
-					held = 0;
-				}
-			}
+			if (e.type == INPUT_FOCUS_LOST)
+				held = 0;
 
-			if (e.type == SDL_KEYDOWN && e.key.repeat == 0) {
-				SDL_Keycode key = e.key.keysym.sym;
+			if (e.type == INPUT_KEY_DOWN) {
+				SDL_Keycode key = e.key;
 
 				// Menu handling
 				if (menu_state != MENU_NONE) {
@@ -1357,12 +1892,14 @@ start_game:
 							aud.started = 1;
 							fprintf(stderr, "[audio] resumed\n");
 							clear_screen_hide_cursor();
+							resume_frames();
 						}
 						draw_menu(menu_state, menu_selection, 0, &settings);
 						continue;
 					}
 
 					if (key == SDLK_UP) {
+						audio_sfx_play(&aud, SFX_MENU_TICK, SFX_GAIN);
 						menu_selection--;
 						if (menu_selection < 0) {
 							menu_selection = (menu_state == MENU_PAUSE) ? 4 : (OPT_COUNT - 1);
@@ -1372,6 +1909,7 @@ start_game:
 					}
 
 					if (key == SDLK_DOWN) {
+						audio_sfx_play(&aud, SFX_MENU_TICK, SFX_GAIN);
 						menu_selection++;
 						int max = (menu_state == MENU_PAUSE) ? 4 : (OPT_COUNT - 1);
 						if (menu_selection > max)
@@ -1387,10 +1925,14 @@ start_game:
 								menu_state = MENU_NONE;
 								aud.started = 1;
 								clear_screen_hide_cursor();
+								resume_frames();
 								break;
 							case 1: // Restart
 								// Restart - reset everything and jump to start_game
 								audio_reset(&aud);
+								audio_stats_reset(&aud);
+								frame_stats = (FrameStats){0};
+								pacer_reset_stats(&pacer);
 								cursor = 0;
 								st.score = 0;
 								st.streak = 0;
@@ -1402,6 +1944,7 @@ start_game:
 								menu_state = MENU_NONE;
 								aud.started = 1;
 								clear_screen_hide_cursor();
+								resume_frames();
 								break;
 							case 2: // Options
 								menu_state = MENU_OPTIONS;
@@ -1411,15 +1954,14 @@ start_game:
 							case 3: // Song List
 								// Return to song list - cleanup current song
 								aud.started = 0;
-								if (aud.dev)
-									SDL_CloseAudioDevice(aud.dev);
-								if (window)
-									SDL_DestroyWindow(window);
+								audio_close(&aud);
+								input_stop(&input);
+								pacer_close(&pacer);
+								evloop_close(&loop);
 								for (int i = 0; i < aud.stem_count; i++)
 									free(aud.stems[i].pcm);
 								free(aud.stems);
-								free(chords.v);
-								free(notes.v);
+								chart_cache_free(&song);
 								for (int i = 0; i < opus_count; i++)
 									free(opus_paths[i]);
 								show_cursor();
@@ -1428,15 +1970,14 @@ start_game:
 							case 4: // Exit
 								// Exit application
 								aud.started = 0;
-								if (aud.dev)
-									SDL_CloseAudioDevice(aud.dev);
-								if (window)
-									SDL_DestroyWindow(window);
+								audio_close(&aud);
+								input_stop(&input);
+								pacer_close(&pacer);
+								evloop_close(&loop);
 								for (int i = 0; i < aud.stem_count; i++)
 									free(aud.stems[i].pcm);
 								free(aud.stems);
-								free(chords.v);
-								free(notes.v);
+								chart_cache_free(&song);
 								for (int i = 0; i < opus_count; i++)
 									free(opus_paths[i]);
 								exit(0);
@@ -1452,6 +1993,21 @@ start_game:
 								// Offset is adjusted with +/-, not Enter
 							} else if (menu_selection == OPT_LOOKAHEAD) {
 								// Lookahead is adjusted with +/-, not Enter
+							} else if (menu_selection == OPT_FRAME_RATE) {
+								// Frame rate is adjusted with +/-, not Enter
+							} else if (menu_selection == OPT_PRECISE_PACING) {
+								settings.precise_pacing = !settings.precise_pacing;
+								pacer.precise = settings.precise_pacing;
+								settings_save(&settings);
+							} else if (menu_selection == OPT_AUDIO_BUFFER) {
+								// Buffer size is adjusted with +/-, not Enter
+							} else if (menu_selection == OPT_REALTIME_AUDIO) {
+								settings.realtime_audio = !settings.realtime_audio;
+								settings_save(&settings);
+							} else if (menu_selection == OPT_INPUT_BACKEND) {
+								settings.input_backend =
+										(settings.input_backend + 1) % INPUT_BACKEND_COUNT;
+								settings_save(&settings);
 							} else if (menu_selection == OPT_INVERTED) {
 								// Toggle inverted mode
 								settings.inverted_mode = !settings.inverted_mode;
@@ -1482,6 +2038,46 @@ start_game:
 						}
 					}
 
+					if (menu_state == MENU_OPTIONS && menu_selection == OPT_FRAME_RATE) {
+						int dir = 0;
+						if (key == SDLK_PLUS || key == SDLK_EQUALS || key == SDLK_KP_PLUS)
+							dir = 1;
+						if (key == SDLK_MINUS || key == SDLK_UNDERSCORE ||
+								key == SDLK_KP_MINUS)
+							dir = -1;
+						if (dir) {
+							step_target_fps(&settings, dir);
+							frame_fps = settings.target_fps;
+							dt = 1.0 / frame_fps;
+							pacer_set_fps(&pacer, frame_fps);
+							pacer_reset_stats(&pacer);
+							frame_stats = (FrameStats){0};
+							settings_save(&settings);
+							draw_menu(menu_state, menu_selection, 0, &settings);
+							continue;
+						}
+					}
+
+					if (menu_state == MENU_OPTIONS && menu_selection == OPT_AUDIO_BUFFER) {
+						int dir = 0;
+						if (key == SDLK_PLUS || key == SDLK_EQUALS || key == SDLK_KP_PLUS)
+							dir = 1;
+						if (key == SDLK_MINUS || key == SDLK_UNDERSCORE ||
+								key == SDLK_KP_MINUS)
+							dir = -1;
+						if (dir) {
+							step_audio_buffer(&settings, dir);
+							aud.autotune = (settings.audio_buffer_size == 0);
+							aud.autotune_window_ns = 0;
+							aud.autotune_clean = 0;
+							audio_reopen(&aud, aud.autotune ? settings.audio_buffer_tuned
+																							: settings.audio_buffer_size);
+							settings_save(&settings);
+							draw_menu(menu_state, menu_selection, 0, &settings);
+							continue;
+						}
+					}
+
 					if (menu_state == MENU_OPTIONS && menu_selection == OPT_LOOKAHEAD) {
 						if (key == SDLK_PLUS || key == SDLK_EQUALS || key == SDLK_KP_PLUS) {
 							settings.lookahead_sec += 0.1;
@@ -1511,11 +2107,19 @@ start_game:
 				if (key == KEY_QUIT)
 					goto cleanup;
 
-				if (key == KEY_MENU) {
+				if (key == KEY_AUDIO_STATS) {
+					show_audio_stats = !show_audio_stats;
+					if (!show_audio_stats)
+						set_hud_line(NULL);
+					continue;
+				}
+
+				if (key == KEY_PAUSE_MENU) {
 					menu_state = MENU_PAUSE;
 					menu_selection = 0;
 					aud.started = 0;
 					fprintf(stderr, "[audio] paused\n");
+					pause_frames();
 					draw_menu(menu_state, menu_selection, 0, &settings);
 					continue;
 				}
@@ -1535,8 +2139,6 @@ start_game:
 					continue;
 				}
 
-				uint8_t old_held = held;
-
 				// Map keys to fret bits - invert if inverted_mode is enabled
 				if (key == settings.key_fret_green)
 					held |= settings.inverted_mode ? (1u << 4) : (1u << 0);
@@ -1549,221 +2151,34 @@ start_game:
 				if (key == settings.key_fret_orange)
 					held |= settings.inverted_mode ? (1u << 0) : (1u << 4);
 
-				// Check for HOPO hit on fret change
-				if (held != old_held && cursor < chords.n && chords.v[cursor].is_hopo) {
-					double offset_sec = total_offset_ms / 1000.0;
-					double t = audio_time_sec(&aud) + offset_sec;
-					double delta = chords.v[cursor].t_sec - t;
-					double ad = fabs(delta);
-
-					if (ad <= bad) {
-						uint8_t expected = chords.v[cursor].mask;
-						int match = 0;
-
-						// Same matching logic as strum
-						int note_count = 0;
-						int highest_fret = -1;
-						for (int l = 0; l < 5; l++) {
-							if (expected & (1u << l)) {
-								note_count++;
-								highest_fret = l;
-							}
-						}
-
-						if (note_count == 1) {
-							int has_required = (held & (1u << highest_fret)) != 0;
-							int invalid_higher = 0;
-							for (int l = highest_fret + 1; l < 5; l++) {
-								if (held & (1u << l)) {
-									invalid_higher = 1;
-									break;
-								}
-							}
-							match = has_required && !invalid_higher;
-						} else {
-							match = (held == expected);
-						}
-
-						if (match) {
-							st.hit++;
-							st.streak++;
-							consecutive_misses = 0; // Reset on hit
-							update_guitar_volume();
-
-							int pts = (ad <= perfect)
-														? POINTS_PERFECT
-														: (ad <= good ? POINTS_GOOD : POINTS_OK);
-							st.score += pts * (1 + st.streak / STREAK_DIVISOR);
-
-							int effect_type;
-							if (ad <= perfect) {
-								effect_type = EFFECT_TYPE_PERFECT;
-							} else if (ad <= good) {
-								effect_type = EFFECT_TYPE_GOOD;
-							} else {
-								effect_type = EFFECT_TYPE_OK;
-							}
-
-							uint8_t m = chords.v[cursor].mask;
-							for (int l = 0; l < 5; l++) {
-								if (m & (1u << l)) {
-									add_effect(l, effect_type, EFFECT_DURATION_HIT);
-								}
-							}
-
-							cursor++;
-						}
-					}
-				}
-
 				if (key >= KEY_TRACK_MIN && key <= KEY_TRACK_MAX) {
 					int new_track = (int)(key - SDLK_0);
-					if (new_track <= max_track && new_track != selected_track) {
-						ChordVec new_chords = {0};
-						build_chords(&notes, diff, new_track, hopo_frequency, &new_chords);
-
-						if (new_chords.n > 0) {
-							selected_track = new_track;
-							free(chords.v);
-							chords = new_chords;
-							cursor = 0;
-							st.score = 0;
-							st.streak = 0;
-							st.hit = 0;
-							st.miss = 0;
-						} else {
-							free(new_chords.v);
-						}
-					}
+					if (new_track <= max_track && new_track != selected_track)
+						switch_chords(diff, new_track, t_event);
 				}
 
-				if (key == KEY_TRACK_ALL) {
-					if (selected_track != -1) {
-						ChordVec new_chords = {0};
-						build_chords(&notes, diff, -1, hopo_frequency, &new_chords);
-
-						if (new_chords.n > 0) {
-							selected_track = -1;
-							free(chords.v);
-							chords = new_chords;
-							cursor = 0;
-							st.score = 0;
-							st.streak = 0;
-							st.hit = 0;
-							st.miss = 0;
-						} else {
-							free(new_chords.v);
+				if (key == KEY_TRACK_ALL && selected_track != -1)
+					switch_chords(diff, -1, t_event);
+
+				// Step to the next difficulty that has notes on this part
+				if (key == KEY_DIFF_DOWN || key == KEY_DIFF_UP) {
+					int step = (key == KEY_DIFF_UP) ? 1 : -1;
+					for (int d = diff + step; d >= 0 && d < 4; d += step) {
+						if (switch_chords(d, selected_track, t_event)) {
+							snprintf(timing_feedback, sizeof(timing_feedback), "%s",
+											 diff_name(d));
+							feedback_timer = 1.0;
+							break;
 						}
 					}
 				}
 
-				if (key == settings.key_strum) {
-					double offset_sec = total_offset_ms / 1000.0;
-					double t = audio_time_sec(&aud) + offset_sec;
-
-					// Notes that passed are already marked as missed in the main loop
-					// Just check if we can hit the current note
-					if (cursor < chords.n) {
-						double delta = chords.v[cursor].t_sec - t;
-						double ad = fabs(delta);
-
-						if (ad <= bad) {
-							uint8_t expected = chords.v[cursor].mask;
-							int match = 0;
-
-							// Count how many notes in the chord
-							int note_count = 0;
-							int highest_fret = -1;
-							for (int l = 0; l < 5; l++) {
-								if (expected & (1u << l)) {
-									note_count++;
-									highest_fret = l;
-								}
-							}
-
-							// Guitar Hero rule: for single notes, allow higher frets + all
-							// lower frets
-							if (note_count == 1) {
-								// Single note: must hold the required fret
-								// Can also hold any frets to the LEFT (lower numbered)
-								int has_required = (held & (1u << highest_fret)) != 0;
-
-								// Check no frets to the RIGHT (higher numbered) are held
-								int invalid_higher = 0;
-								for (int l = highest_fret + 1; l < 5; l++) {
-									if (held & (1u << l)) {
-										invalid_higher = 1;
-										break;
-									}
-								}
-
-								match = has_required && !invalid_higher;
-							} else {
-								// Chord (multiple notes): must match exactly
-								match = (held == expected);
-							}
-
-							if (match) {
-								st.hit++;
-								st.streak++;
-								consecutive_misses = 0; // Reset on hit
-								update_guitar_volume();
-
-								int pts = (ad <= perfect)
-															? POINTS_PERFECT
-															: (ad <= good ? POINTS_GOOD : POINTS_OK);
-								st.score += pts * (1 + st.streak / STREAK_DIVISOR);
-
-								int effect_type;
-								if (ad <= perfect) {
-									effect_type = EFFECT_TYPE_PERFECT;
-								} else if (ad <= good) {
-									effect_type = EFFECT_TYPE_GOOD;
-								} else {
-									effect_type = EFFECT_TYPE_OK;
-								}
-
-								uint8_t m = chords.v[cursor].mask;
-								for (int l = 0; l < 5; l++) {
-									if (m & (1u << l)) {
-										add_effect(l, effect_type, EFFECT_DURATION_HIT);
-									}
-								}
-
-								cursor++;
-							} else {
-								// Miss - show effects on wrong frets and timing feedback
-								uint8_t diff_mask = held ^ expected;
-								for (int l = 0; l < 5; l++) {
-									if (diff_mask & (1u << l)) {
-										add_effect(l, EFFECT_TYPE_MISS, EFFECT_DURATION_MISS);
-									}
-								}
-								st.miss++;
-								st.streak = 0;
-								consecutive_misses++;
-								update_guitar_volume();
-
-								// Show timing feedback for wrong frets
-								snprintf(timing_feedback, sizeof(timing_feedback),
-												 "WRONG FRETS");
-								feedback_timer = 0.5; // Show for 0.5 seconds
-							}
-						} else {
-							// Outside timing window - show too early or too late
-							if (delta > 0) {
-								snprintf(timing_feedback, sizeof(timing_feedback), "TOO EARLY");
-							} else {
-								snprintf(timing_feedback, sizeof(timing_feedback), "TOO LATE");
-							}
-							feedback_timer = 0.5;
-						}
-					}
-				}
+				if (key == settings.key_strum)
+					judge_event(1, t_event);
 			}
 
-			if (e.type == SDL_KEYUP && e.key.repeat == 0) {
-				SDL_Keycode key = e.key.keysym.sym;
+			if (e.type == INPUT_KEY_UP) {
+				SDL_Keycode key = e.key;
 				// Invert key mapping on release as well
 				if (key == settings.key_fret_green)
 					held &= settings.inverted_mode ? ~(1u << 4) : ~(1u << 0);
@@ -1777,81 +2192,31 @@ start_game:
 					held &= settings.inverted_mode ? ~(1u << 0) : ~(1u << 4);
 			}
 
-			// Check for HOPO hit on fret change (hammer-on or pull-off)
-			if (held != old_held && cursor < chords.n && chords.v[cursor].is_hopo) {
-				double offset_sec = total_offset_ms / 1000.0;
-				double t = audio_time_sec(&aud) + offset_sec;
-				double delta = chords.v[cursor].t_sec - t;
-				double ad = fabs(delta);
-
-				if (ad <= bad) {
-					uint8_t expected = chords.v[cursor].mask;
-					int match = 0;
-
-					// Same matching logic as strum
-					int note_count = 0;
-					int highest_fret = -1;
-					for (int l = 0; l < 5; l++) {
-						if (expected & (1u << l)) {
-							note_count++;
-							highest_fret = l;
-						}
-					}
-
-					if (note_count == 1) {
-						int has_required = (held & (1u << highest_fret)) != 0;
-						int invalid_higher = 0;
-						for (int l = highest_fret + 1; l < 5; l++) {
-							if (held & (1u << l)) {
-								invalid_higher = 1;
-								break;
-							}
-						}
-						match = has_required && !invalid_higher;
-					} else {
-						match = (held == expected);
-					}
-
-					if (match) {
-						st.hit++;
-						st.streak++;
-						consecutive_misses = 0; // Reset on hit
-						update_guitar_volume();
-
-						int pts = (ad <= perfect) ? POINTS_PERFECT : (ad <= good ? POINTS_GOOD : POINTS_OK);
-						st.score += pts * (1 + st.streak / STREAK_DIVISOR);
-
-						int effect_type;
-						if (ad <= perfect) {
-							effect_type = EFFECT_TYPE_PERFECT;
-						} else if (ad <= good) {
-							effect_type = EFFECT_TYPE_GOOD;
-						} else {
-							effect_type = EFFECT_TYPE_OK;
-						}
+			// Fret change on a HOPO (hammer-on or pull-off), judged once per event
+			if (held != old_held && cursor < chords->n && chords->is_hopo[cursor])
+				judge_event(0, t_event);
+		}
 
-						uint8_t m = chords.v[cursor].mask;
-						for (int l = 0; l < 5; l++) {
-							if (m & (1u << l)) {
-								add_effect(l, effect_type, EFFECT_DURATION_HIT);
-							}
-						}
+		if (!(ready & LOOP_TICK))
+			continue;
 
-						cursor++;
-					}
-				}
-			}
+		// Most frames of the last second overran: step down a rate for the
+		// rest of the song rather than keep dropping frames unevenly
+		if (pacer_tick(&pacer) && frame_fps > FPS_MIN) {
+			frame_fps = step_fps(frame_fps, -1);
+			dt = 1.0 / frame_fps;
+			pacer_set_fps(&pacer, frame_fps);
+			fprintf(stderr, "[pacer] overloaded, lowering frame rate to %d FPS\n",
+							frame_fps);
 		}
 
-		double offset_sec = total_offset_ms / 1000.0;
-		double t = audio_time_sec(&aud) + offset_sec;
+		int64_t t_us = audio_time_us(&aud) + llround(total_offset_ms * 1000.0);
 
-		if (cursor >= chords.n) {
-			if (t > chords.v[chords.n - 1].t_sec + 2.0) {
+		if (cursor >= chords->n) {
+			if (t_us > chords->t_us[chords->n - 1] + 2000000) {
 				// Song finished - show results and wait for user
 				aud.started = 0;
-				if (aud.dev)
-					SDL_CloseAudioDevice(aud.dev);
+				audio_close(&aud);
 
 				// Display final score
 				clear_screen_hide_cursor();
@@ -1871,37 +2236,59 @@ start_game:
 				printf("  ║                                            ║\n");
 				printf("  ╚════════════════════════════════════════════╝\n");
 				printf("\n");
+				if (frame_stats.frames > 0) {
+					PacerStats ps;
+					pacer_stats(&pacer, &ps);
+					printf("  Render: %d FPS, draw avg %.2f ms, max %.2f ms, %ld/%ld "
+								 "frames over the %.2f ms budget\n",
+								 frame_fps,
+								 frame_stats.draw_sum / (double)frame_stats.frames * 1000.0,
+								 frame_stats.draw_max * 1000.0, frame_stats.over_budget,
+								 frame_stats.frames, dt * 1000.0);
+					printf("  Pacing: wake-up lateness p50 %.0f us, p99 %.0f us, max "
+								 "%.0f us, %llu deadlines skipped\n\n",
+								 ps.late_p50_us, ps.late_p99_us, ps.late_max_us,
+								 (unsigned long long)ps.skipped);
+				}
+				print_audio_report(&aud);
 				printf("  Press ENTER to return to song selection...\n");
 				fflush(stdout);
 
-				// Wait for Enter key using SDL event polling
-				SDL_Event wait_event;
+				// Wait for Enter key from the input thread; no frames to draw
+				evloop_set_tick(&loop, -1);
+				InputEvent wait_event;
 				int waiting = 1;
 				while (waiting) {
-					while (SDL_PollEvent(&wait_event)) {
-						if (wait_event.type == SDL_KEYDOWN) {
-							if (wait_event.key.keysym.sym == SDLK_RETURN ||
-									wait_event.key.keysym.sym == SDLK_RETURN2) {
+					while (input_poll(&input, &wait_event)) {
+						if (wait_event.type == INPUT_KEY_DOWN) {
+							if (wait_event.key == SDLK_RETURN ||
+									wait_event.key == SDLK_RETURN2) {
 								waiting = 0;
 								break;
 							}
 						}
-						if (wait_event.type == SDL_QUIT) {
+						if (wait_event.type == INPUT_QUIT) {
 							waiting = 0;
 							break;
 						}
 					}
-					SDL_Delay(16); // ~60 FPS
+					if (!waiting)
+						break;
+					int ready = evloop_wait(&loop, -1);
+					if (ready & LOOP_INTERRUPT)
+						goto cleanup;
+					if (ready & LOOP_STDIN)
+						tcflush(STDIN_FILENO, TCIFLUSH);
 				}
 
 				// Cleanup
-				if (window)
-					SDL_DestroyWindow(window);
+				input_stop(&input);
+				pacer_close(&pacer);
+				evloop_close(&loop);
 				for (int i = 0; i < aud.stem_count; i++)
 					free(aud.stems[i].pcm);
 				free(aud.stems);
-				free(chords.v);
-				free(notes.v);
+				chart_cache_free(&song);
 				for (int i = 0; i < opus_count; i++)
 					free(opus_paths[i]);
 
@@ -1909,190 +2296,56 @@ start_game:
 			}
 		}
 
-		// Calculate view_cursor to include notes with active sustains
-		// Need to look back far enough to catch sustains that are still playing
-		size_t view_cursor = cursor;
-		while (view_cursor > 0) {
-			const Chord *prev = &chords.v[view_cursor - 1];
-			double sustain_end = prev->t_sec + prev->duration_sec;
-			// Include note if either the note head or sustain end is recent
-			if (prev->t_sec > t - 0.5 || sustain_end > t - 0.3) {
-				view_cursor--;
-			} else {
-				break;
-			}
+		// Step the simulation at SIM_HZ from measured time, so misses, sustains,
+		// effects and timers play the same at any frame rate or render cost
+		double frame_now = now_sec();
+		sim_acc += frame_now - sim_last;
+		sim_last = frame_now;
+		if (sim_acc > SIM_MAX_STEPS * sim_dt)
+			sim_acc = SIM_MAX_STEPS * sim_dt; // Long stall: drop time instead of spiralling
+		while (sim_acc >= sim_dt) {
+			sim_acc -= sim_dt;
+			sim_step(t_us - (int64_t)(sim_acc * 1e6));
 		}
 
-		// Skip game logic if in menu
-		if (menu_state == MENU_NONE) {
-			// Check for missed notes (notes that passed without being hit)
-			while (cursor < chords.n && chords.v[cursor].t_sec < t - bad) {
-				uint8_t m = chords.v[cursor].mask;
-				for (int l = 0; l < 5; l++) {
-					if (m & (1u << l)) {
-						add_effect(l, EFFECT_TYPE_MISS, EFFECT_DURATION_MISS);
-					}
-				}
-				st.miss++;
-				st.streak = 0;
-				consecutive_misses++;
-				update_guitar_volume();
-				cursor++;
-			}
+		// Resize the device buffer if auto-tune saw underruns or a long
+		// clean run
+		int tuned_size = audio_autotune_poll(&aud);
+		if (tuned_size) {
+			settings.audio_buffer_tuned = tuned_size;
+			settings_save(&settings);
 		}
 
-		update_effects(dt);
-		update_multiline_effects(dt);
-
-		// Track active sustains - check if currently held notes have sustains
-		active_sustains = 0;
-		if (menu_state == MENU_NONE) {
-			// Look at notes around cursor to find active sustains
-			for (size_t i = sustain_cursor; i < chords.n && i < cursor + 5; i++) {
-				double note_time = chords.v[i].t_sec;
-				double note_end = note_time + chords.v[i].duration_sec;
-
-				// Check if this note's sustain is currently active
-				if (note_time <= t && t <= note_end && chords.v[i].duration_sec > 0.1) {
-					// Check if the player is holding the correct frets
-					uint8_t note_mask = chords.v[i].mask;
-					if ((held & note_mask) == note_mask) {
-						active_sustains |= note_mask;
-					}
-				}
-
-				// Clean up old sustain tracking
-				if (note_end < t - 1.0 && i >= sustain_cursor) {
-					sustain_cursor = i + 1;
-				}
-			}
+		if (show_audio_stats) {
+			char hud[512];
+			format_frame_hud(&frame_stats, &pacer, hud, sizeof(hud));
+			size_t hud_len = strlen(hud);
+			format_audio_hud(&aud, hud + hud_len, sizeof(hud) - hud_len);
+			set_hud_line(hud);
 		}
-		set_sustain_flames(active_sustains);
 
-		// Celebration effects - start at half bar, intensify as bar fills
 		if (menu_state == MENU_NONE) {
-			int max_streak_for_max_mult = (MAX_MULTIPLIER - 1) * STREAK_DIVISOR;
-			int half_streak = max_streak_for_max_mult / 2;
-			int celebration_active = (st.streak >= half_streak);
-
-			// Just reached half bar - initialize celebration timer
-			if (celebration_active && !was_at_max_multiplier) {
-				// Calculate initial cooldown based on current streak position
-				double progress = (double)(st.streak - half_streak) /
-													(double)(max_streak_for_max_mult - half_streak);
-				if (progress > 1.0)
-					progress = 1.0;
-
-				// Cooldown scales from 2.0s (at half) to 0.3s (at max): 2.0 - (progress
-				// * 1.7)
-				double base_cooldown = 2.0 - (progress * 1.7);
-				// Add small random variance (±10%)
-				celebration_cooldown =
-						base_cooldown * (0.9 + ((double)rand() / RAND_MAX) * 0.2);
-				next_celebration_time = t + celebration_cooldown;
-			}
-
-			// Spawn celebration effects periodically while above half bar
-			if (celebration_active && t >= next_celebration_time) {
-				// Get terminal size for safe spawn zones
-				int rows, cols;
-				get_term_size(&rows, &cols);
-
-				const int lanes = 5;
-				const int lane_w = NOTE_WIDTH;
-				int grid_w = lanes * lane_w;
-				int x0 = (cols - grid_w) / 2;
-				int top_y = 3;
-				int hit_y = top_y + (rows - 3 - 10 < 10 ? 10 : rows - 3);
-
-				// Define safe zones (avoid lanes and permanent UI)
-				int left_zone_x = 5;                 // Left of streak bar
-				int right_zone_x = x0 + grid_w + 15; // Right of lanes
-				int safe_y_min = top_y;
-				int safe_y_max = hit_y - 5;
-
-				// Random effect type: 100 (explosion) or 101 (sparkle)
-				int effect_type = (rand() % 2) + 100;
-
-				// Random position in safe zones
-				int use_right_zone = rand() % 2; // 50% chance left or right
-				int spawn_x, spawn_y;
-
-				if (use_right_zone && right_zone_x + 5 < cols) {
-					// Right zone (after lanes)
-					spawn_x = right_zone_x + (rand() % (cols - right_zone_x - 5));
-				} else if (left_zone_x + 5 < x0) {
-					// Left zone (before lanes but after streak bar)
-					spawn_x = left_zone_x + (rand() % (x0 - left_zone_x - 5));
-				} else {
-					// Fallback: just use a safe spot
-					spawn_x = cols / 4;
-				}
-
-				spawn_y = safe_y_min + (rand() % (safe_y_max - safe_y_min + 1));
-
-				// Spawn the effect
-				add_multiline_effect(spawn_x, spawn_y, effect_type, 0.5, 5, 3);
-
-				// Calculate next cooldown based on current streak position
-				double progress = (double)(st.streak - half_streak) /
-													(double)(max_streak_for_max_mult - half_streak);
-				if (progress > 1.0)
-					progress = 1.0;
-
-				// Cooldown scales from 2.0s (at half) to 0.3s (at max): 2.0 - (progress
-				// * 1.7)
-				double base_cooldown = 2.0 - (progress * 1.7);
-				// Add small random variance (±10%)
-				celebration_cooldown =
-						base_cooldown * (0.9 + ((double)rand() / RAND_MAX) * 0.2);
-				next_celebration_time = t + celebration_cooldown;
-			}
-
-			was_at_max_multiplier = celebration_active;
-		}
-
-		// Update timing feedback timer
-		if (feedback_timer > 0) {
-			feedback_timer -= dt;
-			if (feedback_timer <= 0) {
-				timing_feedback[0] = '\0';
-			}
-		}
-
-		if (menu_state == MENU_NONE) {
-			draw_frame(&chords, view_cursor, t, lookahead, held, &st, song_offset_ms,
-								 global_offset_ms, selected_track, &track_names,
+			double draw_start = now_sec();
+			draw_frame(chords, t_us, lookahead, held, &st, song_offset_ms,
+								 global_offset_ms, selected_track, &song.track_names,
 								 timing_feedback, settings.inverted_mode);
+			frame_stats_add(&frame_stats, now_sec() - draw_start, dt);
 		}
 
-		next += dt;
-		double n = now_sec();
-		double sleep_s = next - n;
-		if (sleep_s > 0) {
-			struct timespec ts;
-			ts.tv_sec = (time_t)sleep_s;
-			ts.tv_nsec = (long)((sleep_s - (double)ts.tv_sec) * 1e9);
-			nanosleep(&ts, NULL);
-		} else {
-			next = n;
-			// Behind schedule; yield briefly
-			usleep(1000);
-		}
+		pacer_arm(&pacer);
 	}
 
 cleanup:
 	aud.started = 0;
-	if (aud.dev)
-		SDL_CloseAudioDevice(aud.dev);
-	if (window)
-		SDL_DestroyWindow(window);
+	audio_close(&aud);
+	input_stop(&input);
+	pacer_close(&pacer);
+	evloop_close(&loop);
 
 	for (int i = 0; i < aud.stem_count; i++)
 		free(aud.stems[i].pcm);
 	free(aud.stems);
-	free(chords.v);
-	free(notes.v);
+	chart_cache_free(&song);
 
 	for (int i = 0; i < opus_count; i++)
 		free(opus_paths[i]);
@@ -3,10 +3,15 @@
 
 #include "midi.h"
 #include "config.h"
-#include <stdio.h>
+#include "tempo.h"
+#include "loaderr.h"
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 static uint32_t be_u32(const uint8_t *p) {
   return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
@@ -58,56 +63,29 @@ static int gh_map_pitch(int pitch, int *out_diff, int *out_lane) {
 
 
 
-void nv_push(NoteVec* a, NoteOn e) {
+int nv_push(NoteVec* a, NoteOn e) {
   if (a->n == a->cap) {
     size_t nc = a->cap ? a->cap * 2 : 2048;
     NoteOn* nv = (NoteOn*)realloc(a->v, nc * sizeof(NoteOn));
-    if (!nv) { perror("realloc"); exit(1); }
+    if (!nv) return -1;
     a->v = nv; a->cap = nc;
   }
   a->v[a->n++] = e;
+  return 0;
 }
 
 
 
 
 
-void tnv_push(TrackNameVec* a, TrackName e) {
+int tnv_push(TrackNameVec* a, TrackName e) {
   if (a->n == a->cap) {
     size_t nc = a->cap ? a->cap * 2 : 16;
     TrackName* nv = (TrackName*)realloc(a->v, nc * sizeof(TrackName));
-    if (!nv) { perror("realloc"); exit(1); }
-    a->v = nv; a->cap = nc;
-  }
-  a->v[a->n++] = e;
-}
-
-typedef struct {
-  uint64_t tick;
-  uint32_t us_per_qn;
-} Tempo;
-
-typedef struct {
-  Tempo* v;
-  size_t n, cap;
-} TempoVec;
-
-static void tv_push(TempoVec* a, Tempo e) {
-  if (a->n == a->cap) {
-    size_t nc = a->cap ? a->cap * 2 : 64;
-    Tempo* nv = (Tempo*)realloc(a->v, nc * sizeof(Tempo));
-    if (!nv) { perror("realloc"); exit(1); }
+    if (!nv) return -1;
     a->v = nv; a->cap = nc;
   }
   a->v[a->n++] = e;
-}
-
-static int cmp_tempo(const void* A, const void* B) {
-  const Tempo* a = (const Tempo*)A;
-  const Tempo* b = (const Tempo*)B;
-  if (a->tick < b->tick) return -1;
-  if (a->tick > b->tick) return 1;
-  // if same tick, keep the last one (stable sort not guaranteed; handle later)
   return 0;
 }
 
@@ -119,66 +97,112 @@ static int cmp_note_tick(const void* A, const void* B) {
   return a->lane - b->lane;
 }
 
-static double tick_to_sec(uint64_t tick, const TempoVec* tv, int tpqn) {
-  // tv must be sorted ascending and must have tv->v[0].tick == 0
-  double sec = 0.0;
-  uint64_t prev_tick = 0;
-  uint32_t cur_us = tv->v[0].us_per_qn;
-
-  size_t i = 1;
-  while (i < tv->n && tv->v[i].tick <= tick) {
-    uint64_t seg_end = tv->v[i].tick;
-    uint64_t dt = seg_end - prev_tick;
-    sec += (double)dt * ((double)cur_us / 1e6) / (double)tpqn;
-
-    prev_tick = seg_end;
-    cur_us = tv->v[i].us_per_qn;
-    i++;
+// Each MTrk yields its notes in tick order, so the note list is a series of
+// sorted runs: fix up same-tick order inside each run, then merge the runs
+// pairwise. O(n log tracks) instead of a full sort. Returns -1 if the merge
+// buffer cannot be allocated.
+static int sort_note_runs(NoteVec* notes, size_t* runs, size_t nruns) {
+  for (size_t r = 0; r < nruns; r++) {
+    for (size_t i = runs[r] + 1; i < runs[r + 1]; i++) {
+      NoteOn x = notes->v[i];
+      size_t j = i;
+      while (j > runs[r] && cmp_note_tick(&notes->v[j - 1], &x) > 0) {
+        notes->v[j] = notes->v[j - 1];
+        j--;
+      }
+      notes->v[j] = x;
+    }
   }
-
-  uint64_t dt = tick - prev_tick;
-  sec += (double)dt * ((double)cur_us / 1e6) / (double)tpqn;
-  return sec;
+  if (nruns < 2 || notes->n < 2)
+    return 0;
+
+  NoteOn* tmp = (NoteOn*)malloc(notes->n * sizeof(NoteOn));
+  if (!tmp) return -1;
+  NoteOn* src = notes->v;
+  NoteOn* dst = tmp;
+  while (nruns > 1) {
+    size_t w = 0;
+    for (size_t r = 0; r < nruns; r += 2) {
+      size_t lo = runs[r], mid = runs[r + 1];
+      size_t hi = (r + 1 < nruns) ? runs[r + 2] : mid;
+      size_t a = lo, b = mid, o = lo;
+      while (a < mid && b < hi)
+        dst[o++] = (cmp_note_tick(&src[b], &src[a]) < 0) ? src[b++] : src[a++];
+      while (a < mid) dst[o++] = src[a++];
+      while (b < hi) dst[o++] = src[b++];
+      runs[w++] = lo;
+    }
+    runs[w] = runs[nruns];
+    nruns = w;
+    NoteOn* t = src; src = dst; dst = t;
+  }
+  if (src != notes->v)
+    memcpy(notes->v, src, notes->n * sizeof(NoteOn));
+  free(tmp);
+  return 0;
 }
 
-static void midi_collect_tempos(const uint8_t* data, size_t len, TempoVec* tempos, int* out_tpqn) {
-  if (len < 14 || memcmp(data, "MThd", 4) != 0) {
-    fprintf(stderr, "Not a valid MIDI (missing MThd)\n");
-    exit(1);
-  }
+// One pass over every MTrk: tempo changes, guitar notes (as ticks) and the
+// track name, decoding each VLQ and running status once. Seconds are filled
+// in afterwards, when the tempo map is complete. Returns -1 with *err set
+// on malformed data or when out of memory.
+static int midi_scan(const uint8_t* data, size_t len, const char* path,
+                     TempoMap* tempos, NoteVec* notes,
+                     TrackNameVec* track_names, LoadError* err) {
+  tempo_map_init(tempos, 192);
+  if (len < 14 || memcmp(data, "MThd", 4) != 0)
+    return load_fail(err, LOAD_ERR_FORMAT, path, 0, "not a MIDI file (missing MThd)");
   uint32_t hdr_len = be_u32(data + 4);
-  if (hdr_len < 6 || 8 + hdr_len > len) {
-    fprintf(stderr, "Invalid MThd length\n");
-    exit(1);
-  }
+  if (hdr_len < 6 || 8 + (uint64_t)hdr_len > len)
+    return load_fail(err, LOAD_ERR_FORMAT, path, 4, "invalid MThd length %u", hdr_len);
 
   uint16_t ntrks = be_u16(data + 10);
   uint16_t div   = be_u16(data + 12);
-  if (div & 0x8000) {
-    fprintf(stderr, "SMPTE time division not supported.\n");
-    exit(1);
-  }
+  if (div & 0x8000)
+    return load_fail(err, LOAD_ERR_FORMAT, path, 12, "SMPTE time division not supported");
   int tpqn = (int)div;
-  if (tpqn <= 0) { fprintf(stderr, "Invalid TPQN\n"); exit(1); }
-  *out_tpqn = tpqn;
+  if (tpqn <= 0)
+    return load_fail(err, LOAD_ERR_FORMAT, path, 12, "invalid ticks per quarter note");
+  tempo_map_init(tempos, tpqn);
 
   size_t pos = 8 + hdr_len;
+  size_t* runs = (size_t*)malloc(((size_t)ntrks + 1) * sizeof(size_t));
+  if (!runs)
+    return load_fail(err, LOAD_ERR_NOMEM, path, LOAD_NO_OFFSET, "cannot allocate track runs");
 
   for (uint16_t trk = 0; trk < ntrks; trk++) {
     if (pos + 8 > len || memcmp(data + pos, "MTrk", 4) != 0) {
-      fprintf(stderr, "Missing MTrk at track %u\n", trk);
-      exit(1);
+      free(runs);
+      return load_fail(err, LOAD_ERR_FORMAT, path, pos, "missing MTrk for track %u", trk);
     }
+    runs[trk] = notes->n;
     uint32_t trk_len = be_u32(data + pos + 4);
     pos += 8;
-    if (pos + trk_len > len) { fprintf(stderr, "Track bounds\n"); exit(1); }
+    if (pos + trk_len > len) {
+      free(runs);
+      return load_fail(err, LOAD_ERR_FORMAT, path, pos - 4,
+                       "track %u length %u runs past the end of the file", trk, trk_len);
+    }
 
     const uint8_t* tdat = data + pos;
     size_t tpos = 0;
     uint8_t running_status = 0;
     uint64_t abs_ticks = 0;
+    int name_open = 1;  // Names count only in the leading meta events
+
+    // Note-ons waiting for their note-off, per pitch (this track only).
+    // Indices into notes->v, which is not reordered until every track is in.
+    // Note-ons past the stack depth are only counted, so their note-offs
+    // do not end (and cut short) a note that is still held.
+    size_t open_idx[128][MIDI_OPEN_NOTE_DEPTH];
+    uint8_t open_n[128];
+    uint32_t open_over[128];
+    memset(open_n, 0, sizeof(open_n));
+    memset(open_over, 0, sizeof(open_over));
 
     while (tpos < trk_len) {
+      if (tpos >= 512)
+        name_open = 0;
       uint32_t dt = read_vlq(tdat, trk_len, &tpos);
       abs_ticks += dt;
       if (tpos >= trk_len) break;
@@ -193,108 +217,29 @@ static void midi_collect_tempos(const uint8_t* data, size_t len, TempoVec* tempo
 
         if (meta_type == 0x51 && mlen == 3) {
           uint32_t us = ((uint32_t)tdat[tpos] << 16) | ((uint32_t)tdat[tpos+1] << 8) | (uint32_t)tdat[tpos+2];
-          tv_push(tempos, (Tempo){ .tick = abs_ticks, .us_per_qn = us });
+          if (us == 0) {
+            // A zero-length quarter note would collapse every later tick onto
+            // one instant (chart.c refuses a BPM <= 0 the same way)
+            free(runs);
+            return load_fail(err, LOAD_ERR_FORMAT, path, pos + tpos,
+                             "track %u: Set Tempo of 0 us per quarter note", trk);
+          }
+          if (tempo_map_add(tempos, abs_ticks, us) != 0)
+            goto nomem;
+        } else if (meta_type == 0x03 && name_open && mlen > 0 && mlen < 64) {
+          // Meta event 0x03 is "Sequence/Track Name"
+          TrackName tn;
+          tn.track_num = (int)trk;
+          memcpy(tn.name, tdat + tpos, mlen);
+          tn.name[mlen] = '\0';
+          if (tnv_push(track_names, tn) != 0)
+            goto nomem;
+          name_open = 0;
         }
         tpos += mlen;
         continue;
       }
-
-      if (b == 0xF0 || b == 0xF7) {
-        uint32_t slen = read_vlq(tdat, trk_len, &tpos);
-        if (tpos + slen > trk_len) break;
-        tpos += slen;
-        running_status = 0;
-        continue;
-      }
-
-      // Skip MIDI events (need to advance correctly for running status)
-      uint8_t status;
-      uint8_t d1;
-
-      if (b & 0x80) {
-        status = b;
-        running_status = status;
-        if (tpos >= trk_len) break;
-        d1 = tdat[tpos++];
-      } else {
-        if (!running_status) continue;
-        status = running_status;
-        d1 = b;
-      }
-
-      uint8_t type = status & 0xF0;
-      if (type == 0xC0 || type == 0xD0) {
-        (void)d1; // one data byte only
-      } else {
-        if (tpos >= trk_len) break;
-        (void)tdat[tpos++]; // d2
-      }
-    }
-
-    pos += trk_len;
-  }
-
-  // Ensure tempo at tick 0
-  qsort(tempos->v, tempos->n, sizeof(Tempo), cmp_tempo);
-  if (tempos->n == 0 || tempos->v[0].tick != 0) {
-    tv_push(tempos, (Tempo){ .tick = 0, .us_per_qn = 500000 }); // 120 BPM default
-    qsort(tempos->v, tempos->n, sizeof(Tempo), cmp_tempo);
-  }
-
-  // If multiple tempos at same tick, keep the last one.
-  // Compact in-place:
-  size_t w = 0;
-  for (size_t i = 0; i < tempos->n; ) {
-    size_t j = i;
-    uint64_t tick = tempos->v[i].tick;
-    uint32_t last = tempos->v[i].us_per_qn;
-    while (j < tempos->n && tempos->v[j].tick == tick) {
-      last = tempos->v[j].us_per_qn;
-      j++;
-    }
-    tempos->v[w++] = (Tempo){ .tick = tick, .us_per_qn = last };
-    i = j;
-  }
-  tempos->n = w;
-}
-
-static void midi_collect_notes_ticks(const uint8_t* data, size_t len, NoteVec* notes, int tpqn) {
-  (void)tpqn; // tpqn not needed here, we keep ticks only
-
-  uint32_t hdr_len = be_u32(data + 4);
-  uint16_t ntrks = be_u16(data + 10);
-
-  size_t pos = 8 + hdr_len;
-
-  for (uint16_t trk = 0; trk < ntrks; trk++) {
-    if (pos + 8 > len || memcmp(data + pos, "MTrk", 4) != 0) {
-      fprintf(stderr, "Missing MTrk at track %u\n", trk);
-      exit(1);
-    }
-    uint32_t trk_len = be_u32(data + pos + 4);
-    pos += 8;
-    if (pos + trk_len > len) { fprintf(stderr, "Track bounds\n"); exit(1); }
-
-    const uint8_t* tdat = data + pos;
-    size_t tpos = 0;
-    uint8_t running_status = 0;
-    uint64_t abs_ticks = 0;
-
-    while (tpos < trk_len) {
-      uint32_t dt = read_vlq(tdat, trk_len, &tpos);
-      abs_ticks += dt;
-      if (tpos >= trk_len) break;
-
-      uint8_t b = tdat[tpos++];
-
-      if (b == 0xFF) {
-        if (tpos >= trk_len) break;
-        (void)tdat[tpos++]; // meta type
-        uint32_t mlen = read_vlq(tdat, trk_len, &tpos);
-        if (tpos + mlen > trk_len) break;
-        tpos += mlen;
-        continue;
-      }
+      name_open = 0;
 
       if (b == 0xF0 || b == 0xF7) {
         uint32_t slen = read_vlq(tdat, trk_len, &tpos);
@@ -325,24 +270,36 @@ static void midi_collect_notes_ticks(const uint8_t* data, size_t len, NoteVec* n
       if (tpos >= trk_len) break;
       d2 = tdat[tpos++];
 
-      if (type == 0x90) {
-        int pitch = (int)d1;
-        int vel   = (int)d2;
-        if (vel > 0) {
-          int diff = -1, lane = -1;
-          if (gh_map_pitch(pitch, &diff, &lane)) {
-            NoteOn ev = {
-              .tick = abs_ticks,
-              .t_sec = 0.0, // set later
-              .pitch = pitch,
-              .lane = lane,
-              .diff = diff,
-              .vel = vel,
-              .track = trk,  // Store MIDI track number
-              .duration_sec = 0.0  // MIDI doesn't track note duration (yet)
-            };
-            nv_push(notes, ev);
-          }
+      int pitch = (int)(d1 & 0x7F);
+      int vel   = (int)d2;
+      int diff = -1, lane = -1;
+      if ((type == 0x80 || type == 0x90) && gh_map_pitch(pitch, &diff, &lane)) {
+        if (type == 0x90 && vel > 0) {
+          NoteOn ev = {
+            .tick = abs_ticks,
+            .t_sec = 0.0, // set later
+            .pitch = pitch,
+            .lane = lane,
+            .diff = diff,
+            .vel = vel,
+            .track = trk,  // Store MIDI track number
+            .dur_ticks = 0,  // Set by the matching note-off
+            .duration_sec = 0.0
+          };
+          if (open_n[pitch] < MIDI_OPEN_NOTE_DEPTH)
+            open_idx[pitch][open_n[pitch]++] = notes->n;
+          else
+            open_over[pitch]++;
+          if (nv_push(notes, ev) != 0)
+            goto nomem;
+        } else if (open_over[pitch] > 0) {
+          open_over[pitch]--;  // Ends an untracked note: it keeps no sustain
+        } else if (open_n[pitch] > 0) {
+          // Note-off, or note-on with velocity 0: ends the latest open note
+          NoteOn* on = &notes->v[open_idx[pitch][--open_n[pitch]]];
+          uint64_t len_ticks = abs_ticks - on->tick;
+          if (len_ticks > (uint64_t)(tpqn / MIDI_SUSTAIN_CUTOFF_DIV))
+            on->dur_ticks = (uint32_t)len_ticks;
         }
       }
     }
@@ -350,81 +307,33 @@ static void midi_collect_notes_ticks(const uint8_t* data, size_t len, NoteVec* n
     pos += trk_len;
   }
 
-  qsort(notes->v, notes->n, sizeof(NoteOn), cmp_note_tick);
-}
+  runs[ntrks] = notes->n;
+  if (sort_note_runs(notes, runs, ntrks) != 0 || tempo_map_finish(tempos) != 0)
+    goto nomem;
+  free(runs);
 
-static void midi_extract_track_names(const uint8_t* data, size_t len, TrackNameVec* track_names) {
-  if (len < 14 || memcmp(data, "MThd", 4) != 0) {
-    return;
+  // Notes are sorted by tick, so one forward walk over the tempo map covers
+  // them: O(notes + tempo changes). Sustain ends are out of order and go
+  // through the binary search.
+  TempoCursor tc = tempo_cursor(tempos);
+  for (size_t i = 0; i < notes->n; i++) {
+    NoteOn* n = &notes->v[i];
+    n->t_sec = tempo_cursor_sec(&tc, n->tick);
+    if (n->dur_ticks)
+      n->duration_sec = tempo_tick_to_sec(tempos, n->tick + n->dur_ticks) - n->t_sec;
   }
-  uint32_t hdr_len = be_u32(data + 4);
-  uint16_t ntrks = be_u16(data + 10);
-
-  size_t pos = 8 + hdr_len;
-
-  for (uint16_t trk = 0; trk < ntrks; trk++) {
-    if (pos + 8 > len || memcmp(data + pos, "MTrk", 4) != 0) {
-      break;
-    }
-    uint32_t trk_len = be_u32(data + pos + 4);
-    pos += 8;
-    if (pos + trk_len > len) break;
-
-    const uint8_t* tdat = data + pos;
-    size_t tpos = 0;
-
-    // Look for track name meta event (0xFF 0x03) at the beginning of the track
-    while (tpos < trk_len && tpos < 512) { // Only check first 512 bytes
-      uint32_t dt = read_vlq(tdat, trk_len, &tpos);
-      (void)dt;
-      if (tpos >= trk_len) break;
-
-      uint8_t b = tdat[tpos++];
-
-      if (b == 0xFF) {
-        if (tpos >= trk_len) break;
-        uint8_t meta_type = tdat[tpos++];
-        uint32_t mlen = read_vlq(tdat, trk_len, &tpos);
-        if (tpos + mlen > trk_len) break;
-
-        // Meta event 0x03 is "Sequence/Track Name"
-        if (meta_type == 0x03 && mlen > 0 && mlen < 64) {
-          TrackName tn;
-          tn.track_num = (int)trk;
-          size_t copy_len = mlen < 63 ? mlen : 63;
-          memcpy(tn.name, tdat + tpos, copy_len);
-          tn.name[copy_len] = '\0';
-          tnv_push(track_names, tn);
-          break; // Found track name, move to next track
-        }
-        tpos += mlen;
-        continue;
-      }
-
-      // Skip other events quickly
-      break;
-    }
+  return 0;
 
-    pos += trk_len;
-  }
+nomem:
+  free(runs);
+  return load_fail(err, LOAD_ERR_NOMEM, path, LOAD_NO_OFFSET, "out of memory");
 }
 
-// parse_midi_file begins below
-static void parse_midi_notes_with_global_tempo(const uint8_t* data, size_t len, NoteVec* out_notes, int* out_tpqn) {
-  TempoVec tempos = {0};
-  int tpqn = 0;
-
-  midi_collect_tempos(data, len, &tempos, &tpqn);
-  midi_collect_notes_ticks(data, len, out_notes, tpqn);
-
-  // Convert ticks -> seconds using global tempo map
-  for (size_t i=0; i<out_notes->n; i++) {
-    out_notes->v[i].t_sec = tick_to_sec(out_notes->v[i].tick, &tempos, tpqn);
-  }
-
-  free(tempos.v);
-  *out_tpqn = tpqn;
+// Parsed note times are rounded onto the integer timeline exactly once, here
+static int64_t sec_to_us(double sec) {
+  return llround(sec * 1e6);
 }
+
 static int cmp_note_time(const void *A, const void *B) {
   const NoteOn *a = (const NoteOn *)A;
   const NoteOn *b = (const NoteOn *)B;
@@ -435,43 +344,32 @@ static int cmp_note_time(const void *A, const void *B) {
   return a->lane - b->lane;
 }
 
-void build_chords(const NoteVec *notes, int diff, int track, int hopo_threshold_ticks, ChordVec *out) {
-  // Collect selected diff and track notes, sort by time, group notes within epsilon into
-  // chords. Use track=-1 to include all tracks.
-  NoteOn *tmp = (NoteOn *)malloc(notes->n * sizeof(NoteOn));
-  if (!tmp) {
-    perror("malloc");
-    exit(1);
-  }
-  size_t m = 0;
-  for (size_t i = 0; i < notes->n; i++) {
-    if (notes->v[i].diff == diff && (track == -1 || notes->v[i].track == track))
-      tmp[m++] = notes->v[i];
-  }
-  if (m == 0) {
-    free(tmp);
-    return;
-  }
-  qsort(tmp, m, sizeof(NoteOn), cmp_note_time);
+// Groups notes within epsilon into chords. tmp holds one part's notes,
+// sorted by cmp_note_time.
+static int group_chords(const NoteOn *tmp, size_t m, int hopo_threshold_ticks, ChordVec *out) {
+  if (m == 0)
+    return 0;
 
-  const double eps = 0.0015; // 1.5ms grouping
-  double cur_t = tmp[0].t_sec;
+  const int64_t eps = 1500; // 1.5ms grouping
+  int64_t cur_t = sec_to_us(tmp[0].t_sec);
   uint8_t cur_mask = 0;
   uint64_t cur_tick = tmp[0].tick;
   int cur_min_vel = 127;  // Track minimum velocity in chord
-  double cur_max_duration = 0.0;  // Track maximum duration in chord
+  int64_t cur_max_duration = 0;  // Track maximum duration in chord
   
   uint64_t prev_tick = 0;  // Previous chord tick for HOPO detection
   uint8_t prev_mask = 0;   // Previous chord mask
 
   for (size_t i = 0; i < m; i++) {
-    if (fabs(tmp[i].t_sec - cur_t) <= eps) {
+    int64_t t_us = sec_to_us(tmp[i].t_sec);
+    int64_t duration_us = sec_to_us(tmp[i].duration_sec);
+    if (llabs(t_us - cur_t) <= eps) {
       cur_mask |= (uint8_t)(1u << tmp[i].lane);
       if (tmp[i].vel < cur_min_vel) {
         cur_min_vel = tmp[i].vel;
       }
-      if (tmp[i].duration_sec > cur_max_duration) {
-        cur_max_duration = tmp[i].duration_sec;
+      if (duration_us > cur_max_duration) {
+        cur_max_duration = duration_us;
       }
     } else {
       // Emit current chord with HOPO detection
@@ -491,15 +389,16 @@ void build_chords(const NoteVec *notes, int diff, int track, int hopo_threshold_
         }
       }
       
-      cv_push(out, (Chord){.t_sec = cur_t, .mask = cur_mask, .is_hopo = is_hopo, .duration_sec = cur_max_duration});
+      if (cv_push(out, (Chord){.t_us = cur_t, .mask = cur_mask, .is_hopo = is_hopo, .duration_us = cur_max_duration}) != 0)
+        return -1;
       
       prev_tick = cur_tick;
       prev_mask = cur_mask;
-      cur_t = tmp[i].t_sec;
+      cur_t = t_us;
       cur_tick = tmp[i].tick;
       cur_mask = (uint8_t)(1u << tmp[i].lane);
       cur_min_vel = tmp[i].vel;
-      cur_max_duration = tmp[i].duration_sec;
+      cur_max_duration = duration_us;
     }
   }
   
@@ -513,56 +412,183 @@ void build_chords(const NoteVec *notes, int diff, int track, int hopo_threshold_
       is_hopo = 1;
     }
   }
-  cv_push(out, (Chord){.t_sec = cur_t, .mask = cur_mask, .is_hopo = is_hopo, .duration_sec = cur_max_duration});
+  return cv_push(out, (Chord){.t_us = cur_t, .mask = cur_mask, .is_hopo = is_hopo, .duration_us = cur_max_duration});
+}
 
+int build_chords(const NoteVec *notes, int diff, int track, int hopo_threshold_ticks, ChordVec *out) {
+  // Collect selected diff and track notes, sort by time, group notes within epsilon into
+  // chords. Use track=-1 to include all tracks.
+  NoteOn *tmp = (NoteOn *)malloc((notes->n ? notes->n : 1) * sizeof(NoteOn));
+  if (!tmp)
+    return -1;
+  size_t m = 0;
+  for (size_t i = 0; i < notes->n; i++) {
+    if (notes->v[i].diff == diff && (track == -1 || notes->v[i].track == track))
+      tmp[m++] = notes->v[i];
+  }
+  qsort(tmp, m, sizeof(NoteOn), cmp_note_time);
+  int rc = group_chords(tmp, m, hopo_threshold_ticks, out);
   free(tmp);
+  return rc;
 }
 
-void midi_parse(const char *path, NoteVec *notes, TrackNameVec *track_names) {
-  FILE *f = fopen(path, "rb");
-  if (!f) {
-    perror("fopen");
-    exit(1);
+int build_chord_tables(const NoteVec *notes, int max_track, int hopo_threshold_ticks,
+                       ChordVec *tables) {
+  // Bucket the notes by difficulty in one counting pass and sort each bucket
+  // once for the all-tracks table. Splitting a sorted bucket by track is a
+  // stable counting pass, so every per-track table comes out sorted too.
+  size_t n = notes->n ? notes->n : 1;
+  size_t slots = (size_t)max_track + 2;
+  NoteOn *by_diff = (NoteOn *)malloc(n * sizeof(NoteOn));
+  NoteOn *by_track = (NoteOn *)malloc(n * sizeof(NoteOn));
+  size_t *first = (size_t *)malloc((slots + 1) * sizeof(size_t));
+  int rc = -1;
+  if (!by_diff || !by_track || !first)
+    goto done;
+
+  size_t diff_first[5] = {0};
+  for (size_t i = 0; i < notes->n; i++)
+    if (notes->v[i].diff >= 0 && notes->v[i].diff < 4)
+      diff_first[notes->v[i].diff + 1]++;
+  for (int d = 0; d < 4; d++)
+    diff_first[d + 1] += diff_first[d];
+  size_t fill[4];
+  memcpy(fill, diff_first, sizeof(fill));
+  for (size_t i = 0; i < notes->n; i++)
+    if (notes->v[i].diff >= 0 && notes->v[i].diff < 4)
+      by_diff[fill[notes->v[i].diff]++] = notes->v[i];
+
+  for (int d = 0; d < 4; d++) {
+    NoteOn *part = by_diff + diff_first[d];
+    size_t m = diff_first[d + 1] - diff_first[d];
+    ChordVec *row = tables + (size_t)d * slots;
+    qsort(part, m, sizeof(NoteOn), cmp_note_time);
+    if (group_chords(part, m, hopo_threshold_ticks, &row[0]) != 0)
+      goto done;
+
+    // first[t + 1] counts track t, then becomes where track t + 1 starts.
+    // Tracks past max_track only appear in the all-tracks table.
+    memset(first, 0, (slots + 1) * sizeof(size_t));
+    for (size_t i = 0; i < m; i++)
+      if (part[i].track >= 0 && part[i].track <= max_track)
+        first[part[i].track + 1]++;
+    for (size_t t = 1; t <= slots; t++)
+      first[t] += first[t - 1];
+    for (size_t i = 0; i < m; i++)
+      if (part[i].track >= 0 && part[i].track <= max_track)
+        by_track[first[part[i].track]++] = part[i];
+    // Placing left first[t] at the end of track t
+    size_t start = 0;
+    for (int t = 0; t <= max_track; t++) {
+      size_t end = first[t];
+      if (group_chords(by_track + start, end - start, hopo_threshold_ticks, &row[t + 1]) != 0)
+        goto done;
+      start = end;
+    }
   }
-  fseek(f, 0, SEEK_END);
-  long sz = ftell(f);
-  fseek(f, 0, SEEK_SET);
-  if (sz <= 0) {
-    fclose(f);
-    fprintf(stderr, "Invalid MIDI file\n");
-    exit(1);
+  rc = 0;
+
+done:
+  free(by_diff);
+  free(by_track);
+  free(first);
+  return rc;
+}
+
+int midi_parse(const char *path, NoteVec *notes, TrackNameVec *track_names, LoadError *err) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return load_fail(err, LOAD_ERR_IO, path, LOAD_NO_OFFSET, "cannot open");
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    load_fail(err, LOAD_ERR_IO, path, LOAD_NO_OFFSET, "cannot stat");
+    close(fd);
+    return -1;
   }
-  uint8_t *buf = (uint8_t *)malloc((size_t)sz);
-  if (!buf) {
-    perror("malloc");
-    fclose(f);
-    exit(1);
+  if (st.st_size <= 0) {
+    close(fd);
+    return load_fail(err, LOAD_ERR_FORMAT, path, 0, "empty MIDI file");
   }
-  if (fread(buf, 1, (size_t)sz, f) != (size_t)sz) {
-    perror("fread");
-    free(buf);
-    fclose(f);
-    exit(1);
+  // Parsed in place from the page cache: no read buffer, no copy
+  size_t sz = (size_t)st.st_size;
+  void *map = mmap(NULL, sz, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (map == MAP_FAILED) {
+    load_fail(err, LOAD_ERR_IO, path, LOAD_NO_OFFSET, "cannot map");
+    close(fd);
+    return -1;
   }
-  fclose(f);
-  
-  int tpqn;
-  parse_midi_notes_with_global_tempo(buf, (size_t)sz, notes, &tpqn);
-  midi_extract_track_names(buf, (size_t)sz, track_names);
-  
-  free(buf);
+  close(fd);
+  madvise(map, sz, MADV_SEQUENTIAL);
+
+  TempoMap tempos;
+  int rc = midi_scan((const uint8_t *)map, sz, path, &tempos, notes, track_names, err);
+  tempo_map_free(&tempos);
+
+  munmap(map, sz);
+  return rc;
+}
+
+// Grows one column to nc entries. On failure the old block stays valid, so
+// the vector can still be freed whole.
+static int cv_grow(void **col, size_t nc, size_t elem) {
+  void *p = realloc(*col, nc * elem);
+  if (!p)
+    return -1;
+  *col = p;
+  return 0;
 }
 
-void cv_push(ChordVec *a, Chord e) {
+int cv_push(ChordVec *a, Chord e) {
   if (a->n == a->cap) {
     size_t nc = a->cap ? a->cap * 2 : 2048;
-    Chord *nv = (Chord *)realloc(a->v, nc * sizeof(Chord));
-    if (!nv) {
-      perror("realloc");
-      exit(1);
-    }
-    a->v = nv;
+    if (cv_grow((void **)&a->t_us, nc, sizeof(int64_t)) != 0 ||
+        cv_grow((void **)&a->end_us, nc, sizeof(int64_t)) != 0 ||
+        cv_grow((void **)&a->max_end_us, nc, sizeof(int64_t)) != 0 ||
+        cv_grow((void **)&a->mask, nc, 1) != 0 ||
+        cv_grow((void **)&a->is_hopo, nc, 1) != 0)
+      return -1;
     a->cap = nc;
   }
-  a->v[a->n++] = e;
+  a->t_us[a->n] = e.t_us;
+  a->end_us[a->n] = e.t_us + e.duration_us;
+  a->max_end_us[a->n] = a->end_us[a->n];
+  if (a->n > 0 && a->max_end_us[a->n - 1] > a->max_end_us[a->n])
+    a->max_end_us[a->n] = a->max_end_us[a->n - 1];
+  a->mask[a->n] = e.mask;
+  a->is_hopo[a->n] = e.is_hopo;
+  a->n++;
+  return 0;
+}
+
+void cv_free(ChordVec *a) {
+  free(a->t_us);
+  free(a->end_us);
+  free(a->max_end_us);
+  free(a->mask);
+  free(a->is_hopo);
+  memset(a, 0, sizeof(*a));
+}
+
+size_t cv_seek(const ChordVec *a, int64_t t_us) {
+  size_t lo = 0, hi = a->n;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (a->t_us[mid] < t_us)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+size_t cv_first_active(const ChordVec *a, int64_t t_us) {
+  size_t lo = 0, hi = a->n;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (a->max_end_us[mid] < t_us)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
 }
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include "loaderr.h"
 
 typedef struct {
   uint64_t tick;
@@ -12,6 +13,7 @@ typedef struct {
   int diff;
   int vel;
   int track;
+  uint32_t dur_ticks;  // Sustain length in ticks, 0 for a plain note
   double duration_sec;  // Note duration in seconds (for sustains/trails)
 } NoteOn;
 
@@ -30,22 +32,69 @@ typedef struct {
   size_t n, cap;
 } TrackNameVec;
 
+// Compiled timeline entry. Times are integer microseconds of song time, so
+// judgments compare exactly against the audio clock however long the song.
 typedef struct {
-  double t_sec;
+  int64_t t_us;
   uint8_t mask;
   uint8_t is_hopo;  // 1 if hammer-on/pull-off, 0 if requires strum
-  double duration_sec;  // Longest note duration in the chord (for sustain trail)
+  uint8_t note_count;  // Frets in mask
+  uint8_t anchor;  // Extra frets that may be held while playing it
+  int64_t duration_us;  // Longest note duration in the chord (for sustain trail)
 } Chord;
 
+// Guitar Hero anchoring: a single note may be played with any lower frets
+// held too, a chord must be fretted exactly.
+static inline uint8_t chord_anchor_mask(uint8_t mask) {
+  if (mask == 0 || (mask & (mask - 1)))
+    return 0;
+  return (uint8_t)(mask - 1);
+}
+
+// The chord timeline as parallel columns: the per-frame scans (visible
+// range, miss sweep, sustains) each read only the columns they test.
+// cv_get() assembles a Chord for judging.
 typedef struct {
-  Chord *v;
+  int64_t *t_us;    // Start times, ascending
+  int64_t *end_us;  // t_us + longest sustain
+  int64_t *max_end_us;  // Running max of end_us: an interval index
+  uint8_t *mask;
+  uint8_t *is_hopo;
   size_t n, cap;
 } ChordVec;
 
-void nv_push(NoteVec* a, NoteOn e);
-void tnv_push(TrackNameVec* a, TrackName e);
-void cv_push(ChordVec *a, Chord e);
-void build_chords(const NoteVec *notes, int diff, int track, int hopo_threshold_ticks, ChordVec *out);
-void midi_parse(const char *path, NoteVec *notes, TrackNameVec *track_names);
+static inline Chord cv_get(const ChordVec *a, size_t i) {
+  uint8_t mask = a->mask[i];
+  return (Chord){.t_us = a->t_us[i],
+                 .mask = mask,
+                 .is_hopo = a->is_hopo[i],
+                 .note_count = (uint8_t)__builtin_popcount(mask),
+                 .anchor = chord_anchor_mask(mask),
+                 .duration_us = a->end_us[i] - a->t_us[i]};
+}
+
+// The push functions return -1 when out of memory, leaving the vector as it was
+int nv_push(NoteVec* a, NoteOn e);
+int tnv_push(TrackNameVec* a, TrackName e);
+int cv_push(ChordVec *a, Chord e);
+void cv_free(ChordVec *a);
+// Index of the first chord at or after t_us (binary search)
+size_t cv_seek(const ChordVec *a, int64_t t_us);
+// Index of the first chord still sounding at t_us (end_us >= t_us). Chords
+// intersecting [lo, hi] all lie in cv_first_active(lo) .. cv_seek(hi + 1),
+// found in O(log n); the ones in between that ended before lo (short notes
+// under a long sustain) are for the caller to skip.
+size_t cv_first_active(const ChordVec *a, int64_t t_us);
+// Returns -1 when out of memory
+int build_chords(const NoteVec *notes, int diff, int track, int hopo_threshold_ticks, ChordVec *out);
+// Every (difficulty, track) table at once, in O(n log n) over the notes
+// rather than one scan per table. tables has 4 * (max_track + 2) zeroed
+// entries laid out [diff * (max_track + 2) + track + 1], track -1 being all
+// tracks. Returns -1 when out of memory.
+int build_chord_tables(const NoteVec *notes, int max_track, int hopo_threshold_ticks,
+                       ChordVec *tables);
+// Returns 0, or -1 with *err (may be NULL) saying why the file was rejected.
+// Notes read before a failure are left in *notes for the caller to free.
+int midi_parse(const char *path, NoteVec *notes, TrackNameVec *track_names, LoadError *err);
 
 #endif
@@ -0,0 +1,125 @@
+#define _DEFAULT_SOURCE
+#define _POSIX_C_SOURCE 200809L
+
+#include "pacer.h"
+#include "config.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+static inline uint64_t mono_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline struct timespec ns_to_timespec(uint64_t ns) {
+  struct timespec ts = {.tv_sec = (time_t)(ns / 1000000000ull),
+                        .tv_nsec = (long)(ns % 1000000000ull)};
+  return ts;
+}
+
+int pacer_init(Pacer *p, int fps, int precise) {
+  memset(p, 0, sizeof(*p));
+  p->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (p->fd < 0) {
+    perror("timerfd_create");
+    return -1;
+  }
+  p->precise = precise;
+  pacer_set_fps(p, fps);
+  return 0;
+}
+
+void pacer_close(Pacer *p) {
+  if (p->fd >= 0)
+    close(p->fd);
+  p->fd = -1;
+}
+
+void pacer_set_fps(Pacer *p, int fps) {
+  p->fps = fps;
+  p->period_ns = 1000000000ull / (uint64_t)fps;
+  p->next_ns = mono_ns() + p->period_ns;
+  p->window_frames = 0;
+  p->window_missed = 0;
+  pacer_arm(p);
+}
+
+void pacer_arm(Pacer *p) {
+  uint64_t spin_ns = p->precise ? (uint64_t)PACER_SPIN_US * 1000ull : 0;
+  uint64_t wake = p->next_ns > spin_ns ? p->next_ns - spin_ns : 1;
+  struct itimerspec its = {.it_value = ns_to_timespec(wake)};
+  timerfd_settime(p->fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+int pacer_tick(Pacer *p) {
+  uint64_t expirations;
+  ssize_t n = read(p->fd, &expirations, sizeof(expirations));
+  (void)n;  // Nonblocking; an early call just spins below
+
+  uint64_t deadline = p->next_ns;
+  uint64_t now = mono_ns();
+  // Woken well past the deadline: the last frame's work overran the period
+  int missed = (now >= deadline + (uint64_t)PACER_SPIN_US * 1000ull);
+
+  while (now < deadline)
+    now = mono_ns();  // Precise mode: spin out the last stretch
+
+  uint64_t late = now - deadline;
+  int bucket = (int)(late / 1000ull / PACER_HIST_STEP_US);
+  if (bucket >= PACER_HIST_BUCKETS)
+    bucket = PACER_HIST_BUCKETS - 1;
+  p->late_hist[bucket]++;
+  if (late > p->late_max_ns)
+    p->late_max_ns = late;
+  p->frames++;
+
+  // Next deadline stays on the original grid; whole periods that are
+  // already gone are skipped instead of being rendered back to back
+  p->next_ns = deadline + p->period_ns;
+  if (p->next_ns <= now) {
+    uint64_t behind = (now - p->next_ns) / p->period_ns + 1;
+    p->next_ns += behind * p->period_ns;
+    p->skipped += behind;
+  }
+
+  p->window_missed += missed;
+  if (++p->window_frames >= p->fps) {
+    int overloaded = p->window_missed * 2 > p->window_frames;
+    p->window_frames = 0;
+    p->window_missed = 0;
+    return overloaded;
+  }
+  return 0;
+}
+
+static double hist_percentile(const uint64_t *hist, uint64_t total, double pct) {
+  if (total == 0)
+    return 0.0;
+  uint64_t want = (uint64_t)((double)total * pct);
+  uint64_t acc = 0;
+  for (int b = 0; b < PACER_HIST_BUCKETS; b++) {
+    acc += hist[b];
+    if (acc > want)
+      return (double)((b + 1) * PACER_HIST_STEP_US);  // Bucket upper bound
+  }
+  return (double)(PACER_HIST_BUCKETS * PACER_HIST_STEP_US);
+}
+
+void pacer_stats(const Pacer *p, PacerStats *out) {
+  out->frames = p->frames;
+  out->skipped = p->skipped;
+  out->late_p50_us = hist_percentile(p->late_hist, p->frames, 0.50);
+  out->late_p99_us = hist_percentile(p->late_hist, p->frames, 0.99);
+  out->late_max_us = (double)p->late_max_ns / 1000.0;
+}
+
+void pacer_reset_stats(Pacer *p) {
+  memset(p->late_hist, 0, sizeof(p->late_hist));
+  p->late_max_ns = 0;
+  p->frames = 0;
+  p->skipped = 0;
+}
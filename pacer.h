@@ -0,0 +1,54 @@
+#ifndef PACER_H
+#define PACER_H
+
+#include "config.h"
+#include <stdint.h>
+
+// Frame pacer on absolute CLOCK_MONOTONIC deadlines. The timerfd is armed
+// for each deadline (PACER_SPIN_US earlier in precise mode, which then spins
+// the rest) and waited on by the caller's event loop. Missed deadlines are
+// skipped in whole periods, so the phase never drifts.
+typedef struct {
+  int fd;  // timerfd
+  int fps;
+  int precise;
+  uint64_t period_ns;
+  uint64_t next_ns;  // Next frame deadline
+
+  // Lateness of each wake-up past its deadline
+  uint64_t late_hist[PACER_HIST_BUCKETS];
+  uint64_t late_max_ns;
+  uint64_t frames;
+  uint64_t skipped;  // Deadlines dropped because a frame overran them
+
+  // Overload detection over a one-second window of frames
+  int window_frames;
+  int window_missed;
+} Pacer;
+
+typedef struct {
+  double late_p50_us;
+  double late_p99_us;
+  double late_max_us;
+  uint64_t frames;
+  uint64_t skipped;
+} PacerStats;
+
+// Returns -1 if the timerfd cannot be created
+int pacer_init(Pacer *p, int fps, int precise);
+void pacer_close(Pacer *p);
+void pacer_set_fps(Pacer *p, int fps);  // Also re-arms the timer
+
+// Arm the timerfd for the next deadline; it becomes readable at that point.
+void pacer_arm(Pacer *p);
+
+// Call once the timerfd is readable: consumes it, spins to the deadline in
+// precise mode and schedules the next one (the caller re-arms after drawing).
+// Returns 1 when most frames of the last second missed their deadline: the
+// caller should lower the frame rate.
+int pacer_tick(Pacer *p);
+
+void pacer_stats(const Pacer *p, PacerStats *out);
+void pacer_reset_stats(Pacer *p);
+
+#endif
@@ -1,5 +1,6 @@
 #include "settings.h"
 #include "config.h"
+#include "input.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -19,6 +20,13 @@ void settings_init_defaults(Settings *s) {
   s->lookahead_sec = DEFAULT_LOOKAHEAD;
   s->last_difficulty = 3;  // Default to Expert
   s->last_song_index = 0;  // Default to first song
+  s->audio_buffer_size = DEFAULT_AUDIO_BUFFER;
+  s->audio_buffer_tuned = AUDIO_BUFFER_MIN;
+  s->realtime_audio = 0;
+  s->precise_pacing = 0;
+  s->target_fps = (int)TARGET_FPS;
+  s->input_backend = INPUT_BACKEND_SDL;
+  snprintf(s->evdev_device, sizeof(s->evdev_device), "%s", DEFAULT_EVDEV_DEVICE);
 }
 
 static const char* get_settings_path(void) {
@@ -72,6 +80,29 @@ void settings_load(Settings *s) {
     } else if (sscanf(line, "last_song_index=%d", &value) == 1) {
       s->last_song_index = value;
       if (s->last_song_index < 0) s->last_song_index = 0;
+    } else if (sscanf(line, "audio_buffer_size=%d", &value) == 1) {
+      s->audio_buffer_size = value;
+      if (s->audio_buffer_size != 0 &&
+          (s->audio_buffer_size < AUDIO_BUFFER_MIN || s->audio_buffer_size > AUDIO_BUFFER_MAX))
+        s->audio_buffer_size = DEFAULT_AUDIO_BUFFER;
+    } else if (sscanf(line, "audio_buffer_tuned=%d", &value) == 1) {
+      s->audio_buffer_tuned = value;
+      if (s->audio_buffer_tuned < AUDIO_BUFFER_MIN || s->audio_buffer_tuned > AUDIO_BUFFER_MAX)
+        s->audio_buffer_tuned = AUDIO_BUFFER_MIN;
+    } else if (sscanf(line, "realtime_audio=%d", &value) == 1) {
+      s->realtime_audio = value ? 1 : 0;
+    } else if (sscanf(line, "target_fps=%d", &value) == 1) {
+      s->target_fps = value;
+      if (s->target_fps < FPS_MIN || s->target_fps > FPS_MAX)
+        s->target_fps = (int)TARGET_FPS;
+    } else if (sscanf(line, "precise_pacing=%d", &value) == 1) {
+      s->precise_pacing = value ? 1 : 0;
+    } else if (sscanf(line, "input_backend=%d", &value) == 1) {
+      s->input_backend = value;
+      if (s->input_backend < 0 || s->input_backend >= INPUT_BACKEND_COUNT)
+        s->input_backend = INPUT_BACKEND_SDL;
+    } else if (sscanf(line, "evdev_device=%255s", s->evdev_device) == 1) {
+      // Path or "auto"
     }
   }
   
@@ -97,6 +128,13 @@ void settings_save(const Settings *s) {
   fprintf(f, "inverted_mode=%d\n", s->inverted_mode);
   fprintf(f, "last_difficulty=%d\n", s->last_difficulty);
   fprintf(f, "last_song_index=%d\n", s->last_song_index);
+  fprintf(f, "audio_buffer_size=%d\n", s->audio_buffer_size);
+  fprintf(f, "audio_buffer_tuned=%d\n", s->audio_buffer_tuned);
+  fprintf(f, "realtime_audio=%d\n", s->realtime_audio);
+  fprintf(f, "target_fps=%d\n", s->target_fps);
+  fprintf(f, "precise_pacing=%d\n", s->precise_pacing);
+  fprintf(f, "input_backend=%d\n", s->input_backend);
+  fprintf(f, "evdev_device=%s\n", s->evdev_device);
   
   fclose(f);
 }
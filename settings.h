@@ -15,6 +15,13 @@ typedef struct {
   double lookahead_sec;  // How far ahead notes are visible (in seconds)
   int last_difficulty;  // Last selected difficulty (0-3)
   int last_song_index;  // Last selected song index in list
+  int audio_buffer_size;  // Frames per callback, 0 = auto-tune
+  int audio_buffer_tuned;  // Last size auto-tune settled on (start point)
+  int realtime_audio;  // mlock stems and run the callback at SCHED_FIFO
+  int target_fps;  // Gameplay frame rate (FPS_MIN..FPS_MAX)
+  int precise_pacing;  // Spin out the last PACER_SPIN_US of each frame
+  int input_backend;  // InputBackend: SDL window or evdev
+  char evdev_device[256];  // /dev/input/eventN, or "auto" for every keyboard
 } Settings;
 
 void settings_load(Settings *s);
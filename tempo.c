@@ -0,0 +1,119 @@
+#include "tempo.h"
+#include "config.h"
+#include <stdlib.h>
+
+void tempo_map_init(TempoMap *m, int resolution) {
+  m->v = NULL;
+  m->n = m->cap = 0;
+  m->resolution = resolution > 0 ? resolution : 192;
+}
+
+void tempo_map_free(TempoMap *m) {
+  free(m->v);
+  m->v = NULL;
+  m->n = m->cap = 0;
+}
+
+int tempo_map_add(TempoMap *m, uint64_t tick, uint32_t us_per_qn) {
+  if (m->n == m->cap) {
+    size_t nc = m->cap ? m->cap * 2 : 64;
+    TempoSeg *nv = (TempoSeg *)realloc(m->v, nc * sizeof(TempoSeg));
+    if (!nv)
+      return -1;
+    m->v = nv;
+    m->cap = nc;
+  }
+  m->v[m->n] = (TempoSeg){.tick = tick, .us_per_qn = us_per_qn, .seq = (uint32_t)m->n};
+  m->n++;
+  return 0;
+}
+
+static int cmp_seg(const void *A, const void *B) {
+  const TempoSeg *a = (const TempoSeg *)A;
+  const TempoSeg *b = (const TempoSeg *)B;
+  if (a->tick != b->tick)
+    return a->tick < b->tick ? -1 : 1;
+  return a->seq < b->seq ? -1 : (a->seq > b->seq);
+}
+
+int tempo_map_finish(TempoMap *m) {
+  // Files are normally already in order; only sort when they are not
+  int sorted = 1;
+  for (size_t i = 1; i < m->n && sorted; i++)
+    sorted = cmp_seg(&m->v[i - 1], &m->v[i]) <= 0;
+  if (!sorted)
+    qsort(m->v, m->n, sizeof(TempoSeg), cmp_seg);
+
+  // Keep the last change at each tick
+  size_t w = 0;
+  for (size_t i = 0; i < m->n; i++) {
+    if (w > 0 && m->v[w - 1].tick == m->v[i].tick)
+      w--;
+    m->v[w++] = m->v[i];
+  }
+  m->n = w;
+
+  if (m->n == 0 || m->v[0].tick != 0) {
+    if (tempo_map_add(m, 0, DEFAULT_TEMPO_USPQN) != 0)  // MIDI's implied 120 BPM
+      return -1;
+    TempoSeg first = m->v[m->n - 1];
+    for (size_t i = m->n - 1; i > 0; i--)
+      m->v[i] = m->v[i - 1];
+    m->v[0] = first;
+  }
+
+  double sec = 0.0;
+  for (size_t i = 0; i < m->n; i++) {
+    TempoSeg *s = &m->v[i];
+    if (i > 0)
+      sec += (double)(s->tick - m->v[i - 1].tick) * m->v[i - 1].sec_per_tick;
+    s->start_sec = sec;
+    s->sec_per_tick = (double)s->us_per_qn / 1e6 / (double)m->resolution;
+  }
+  return 0;
+}
+
+// Last segment starting at or before tick
+static size_t seg_for_tick(const TempoMap *m, uint64_t tick) {
+  size_t lo = 0, hi = m->n;
+  while (hi - lo > 1) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (m->v[mid].tick <= tick)
+      lo = mid;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+static inline double seg_sec(const TempoSeg *s, uint64_t tick) {
+  return s->start_sec + (double)(tick - s->tick) * s->sec_per_tick;
+}
+
+double tempo_tick_to_sec(const TempoMap *m, uint64_t tick) {
+  return seg_sec(&m->v[seg_for_tick(m, tick)], tick);
+}
+
+double tempo_sec_to_tick(const TempoMap *m, double sec) {
+  if (sec <= 0.0)
+    return 0.0;
+  size_t lo = 0, hi = m->n;
+  while (hi - lo > 1) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (m->v[mid].start_sec <= sec)
+      lo = mid;
+    else
+      hi = mid;
+  }
+  const TempoSeg *s = &m->v[lo];
+  return (double)s->tick + (sec - s->start_sec) / s->sec_per_tick;
+}
+
+double tempo_cursor_sec(TempoCursor *c, uint64_t tick) {
+  const TempoMap *m = c->m;
+  if (tick < m->v[c->seg].tick)
+    c->seg = seg_for_tick(m, tick);
+  while (c->seg + 1 < m->n && m->v[c->seg + 1].tick <= tick)
+    c->seg++;
+  return seg_sec(&m->v[c->seg], tick);
+}
@@ -0,0 +1,53 @@
+#ifndef TEMPO_H
+#define TEMPO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// One constant-tempo stretch of the song. start_sec is the prefix sum of all
+// earlier segments, so converting a tick only touches its own segment.
+typedef struct {
+  uint64_t tick;       // First tick of the segment
+  uint32_t us_per_qn;  // Microseconds per quarter note
+  uint32_t seq;        // Insertion order: the last tempo at a tick wins
+  double start_sec;    // Song time at `tick`
+  double sec_per_tick;
+} TempoSeg;
+
+// Tempo map shared by the MIDI and .chart parsers. Add changes in any
+// order, then call tempo_map_finish() before converting.
+typedef struct {
+  TempoSeg *v;
+  size_t n, cap;
+  int resolution;  // Ticks per quarter note
+} TempoMap;
+
+void tempo_map_init(TempoMap *m, int resolution);
+void tempo_map_free(TempoMap *m);
+// Returns -1 if the map could not grow
+int tempo_map_add(TempoMap *m, uint64_t tick, uint32_t us_per_qn);
+
+// Sort, keep the last change per tick, default to 120 BPM before the first
+// change and compute the per-segment prefix sums. Call after the last add
+// (or after changing resolution). Returns -1 if out of memory.
+int tempo_map_finish(TempoMap *m);
+
+// Random access, O(log segments)
+double tempo_tick_to_sec(const TempoMap *m, uint64_t tick);
+double tempo_sec_to_tick(const TempoMap *m, double sec);
+
+// Merge walk: converting non-decreasing ticks through one cursor is O(1)
+// amortized, so a sorted note list converts in O(notes + segments). Going
+// backwards is allowed and falls back to a binary search.
+typedef struct {
+  const TempoMap *m;
+  size_t seg;
+} TempoCursor;
+
+static inline TempoCursor tempo_cursor(const TempoMap *m) {
+  return (TempoCursor){.m = m, .seg = 0};
+}
+
+double tempo_cursor_sec(TempoCursor *c, uint64_t tick);
+
+#endif
@@ -31,11 +31,15 @@ const char *lane_color(int lane) {
 }
 
 static struct termios g_old_term;
+static int g_raw;
 
 void term_raw_on(void) {
   struct termios t;
+  if (g_raw)
+    return;  // Keep the original settings saved by the first call
   if (tcgetattr(STDIN_FILENO, &g_old_term) != 0)
     return;
+  g_raw = 1;
   t = g_old_term;
   t.c_lflag &= (tcflag_t) ~(ICANON | ECHO);
   t.c_cc[VMIN] = 0;
@@ -43,7 +47,12 @@ void term_raw_on(void) {
   tcsetattr(STDIN_FILENO, TCSANOW, &t);
 }
 
-void term_raw_off(void) { tcsetattr(STDIN_FILENO, TCSANOW, &g_old_term); }
+void term_raw_off(void) {
+  if (!g_raw)
+    return;
+  tcsetattr(STDIN_FILENO, TCSANOW, &g_old_term);
+  g_raw = 0;
+}
 
 void get_term_size(int *rows, int *cols) {
   struct winsize ws;
@@ -76,6 +85,9 @@ static MultilineEffect g_multiline_effects[MAX_MULTILINE_EFFECTS];
 static int g_multiline_effect_count = 0;
 
 static uint8_t g_sustain_flames = 0;
+static double g_flame_time = 0.0;  // Flame animation clock, advanced by the simulation
+
+static char g_hud_line[512] = "";
 
 static const char* EXPLOSION_FRAMES[3][3] = {
   {" \\|/ ", "-.*.-", " /|\\ "},
@@ -126,6 +138,9 @@ void update_effects(double dt) {
     }
   }
   g_effect_count = write_idx;
+
+  if (g_sustain_flames)
+    g_flame_time += dt;
 }
 
 void add_multiline_effect(int x, int y, int type, double duration, int width, int height) {
@@ -159,7 +174,55 @@ void set_sustain_flames(uint8_t lane_mask) {
   g_sustain_flames = lane_mask;
 }
 
-void draw_frame(const ChordVec *chords, size_t cursor, double t,
+void set_hud_line(const char *text) {
+  snprintf(g_hud_line, sizeof(g_hud_line), "%s", text ? text : "");
+}
+
+#define COLOR_CODE_NONE -1
+
+// Escape for a cell color code: lanes 0-4, hit effects -10..-13 (miss, OK,
+// good, perfect), streak bar -20 (empty) and -21..-24 (2x, 3x, 4x, 1x)
+static const char *color_code_escape(int code) {
+  switch (code) {
+  case -10: return "\x1b[1;31m";  // Miss - bright red
+  case -11: return "\x1b[1;36m";  // OK - bright cyan
+  case -12: return "\x1b[1;32m";  // Good - bright green
+  case -13: return "\x1b[1;33m";  // Perfect - bright yellow
+  case -20: return "\x1b[2;37m";  // Empty streak bar - gray
+  case -21: return "\x1b[1;32m";  // 2x multiplier - green
+  case -22: return "\x1b[1;35m";  // 3x multiplier - magenta
+  case -23: return "\x1b[1;33m";  // 4x multiplier - yellow
+  case -24: return "\x1b[1;34m";  // 1x multiplier - blue
+  default: return lane_color(code);
+  }
+}
+
+// Frame buffers grow with the terminal and are never freed per frame. The
+// output buffer allows for a color escape plus reset around every cell.
+static char *g_screen;
+static int8_t *g_color;
+static char *g_out;
+static size_t g_frame_cells;
+
+static int frame_reserve(size_t cells) {
+  if (cells <= g_frame_cells)
+    return 1;
+  char *screen = (char *)realloc(g_screen, cells);
+  if (screen)
+    g_screen = screen;
+  int8_t *color = (int8_t *)realloc(g_color, cells);
+  if (color)
+    g_color = color;
+  char *out = (char *)realloc(g_out, cells * 24 + 64);
+  if (out)
+    g_out = out;
+  if (!screen || !color || !out)
+    return 0;
+  g_frame_cells = cells;
+  return 1;
+}
+
+void draw_frame(const ChordVec *chords, int64_t t_us,
                 double lookahead, uint8_t held_mask, const Stats *st,
                 double song_offset_ms, double global_offset_ms,
                 int selected_track __attribute__((unused)),
@@ -183,26 +246,35 @@ void draw_frame(const ChordVec *chords, size_t cursor, double t,
     return inverted_mode ? (4 - lane) : lane;
   }
 
-  // buffer
-  char *screen = (char *)malloc((size_t)rows * (size_t)(cols + 1));
-  if (!screen)
+  // Character and per-cell color buffers, reused across frames
+  size_t cells = (size_t)rows * (size_t)(cols + 1);
+  if (!frame_reserve(cells))
     return;
+  char *screen = g_screen;
+  int8_t *color = g_color;
   for (int r = 0; r < rows; r++) {
     memset(screen + (size_t)r * (size_t)(cols + 1), ' ', (size_t)cols);
     screen[(size_t)r * (size_t)(cols + 1) + (size_t)cols] = '\0';
   }
+  memset(color, COLOR_CODE_NONE, cells);
 
   // Row 1: Stats line with both offsets
   int total_notes = st->hit + st->miss;
   char statsline[512];
   snprintf(statsline, sizeof(statsline),
            "t=%.3fs  GlobalOffset: %.1fms  SongOffset: %.1fms  Score: \x1b[93m%d\x1b[0m  Streak: %d  Hit: %d/%d",
-           t, global_offset_ms, song_offset_ms, st->score, st->streak, st->hit, total_notes);
+           (double)t_us / 1e6, global_offset_ms, song_offset_ms, st->score, st->streak, st->hit, total_notes);
   int hl = (int)strlen(statsline);
   if (hl > cols)
     hl = cols;
   memcpy(screen + 1 * (cols + 1), statsline, (size_t)hl); // Row 1
 
+  // Row 2: optional debug HUD (audio timing etc.)
+  int hud_len = (int)strlen(g_hud_line);
+  if (hud_len > cols)
+    hud_len = cols;
+  memcpy(screen + 2 * (cols + 1), g_hud_line, (size_t)hud_len);
+
   int top_y = 3; // Leave row 2 empty (between stats and lanes)
   int hit_y = top_y + h;
   if (hit_y >= rows - 1) // Just leave bottom row empty
@@ -253,15 +325,6 @@ void draw_frame(const ChordVec *chords, size_t cursor, double t,
     screen[(size_t)hit_y * (size_t)(cols + 1) + (size_t)x] = '-';
   }
 
-  // Colored character tracking
-  typedef struct {
-    int lane;
-    size_t pos;
-  } ColoredChar;
-  ColoredChar
-      colored[8192]; // arbitrary max colored chars (increased for guides)
-  int colored_count = 0;
-
   // Color the streak bar - entire bar matches current multiplier color
   for (int y = top_y; y <= hit_y && y < rows; y++) {
     int dy = hit_y - y;  // Distance from bottom
@@ -283,16 +346,8 @@ void draw_frame(const ChordVec *chords, size_t cursor, double t,
     }
     
     // Add both x=0 and x=1 positions
-    if (colored_count < 8192) {
-      colored[colored_count].lane = bar_lane_code;
-      colored[colored_count].pos = (size_t)y * (size_t)(cols + 1) + 0;
-      colored_count++;
-    }
-    if (colored_count < 8192) {
-      colored[colored_count].lane = bar_lane_code;
-      colored[colored_count].pos = (size_t)y * (size_t)(cols + 1) + 1;
-      colored_count++;
-    }
+    color[(size_t)y * (size_t)(cols + 1) + 0] = bar_lane_code;
+    color[(size_t)y * (size_t)(cols + 1) + 1] = bar_lane_code;
   }
 
   // Draw graphical feedback on LEFT side of lanes
@@ -311,11 +366,7 @@ void draw_frame(const ChordVec *chords, size_t cursor, double t,
           screen[(size_t)hit_y * (size_t)(cols + 1) + (size_t)(left_x + 4)] = 'X';
           
           for (int i = 0; i < 5; i++) {
-            if (colored_count < 8192) {
-              colored[colored_count].lane = -10;  // Miss color
-              colored[colored_count].pos = (size_t)hit_y * (size_t)(cols + 1) + (size_t)(left_x + i);
-              colored_count++;
-            }
+            color[(size_t)hit_y * (size_t)(cols + 1) + (size_t)(left_x + i)] = -10;  // Miss color
           }
         }
       } else if (effect_type == 3) {
@@ -328,11 +379,7 @@ void draw_frame(const ChordVec *chords, size_t cursor, double t,
           screen[(size_t)hit_y * (size_t)(cols + 1) + (size_t)(left_x + 4)] = '=';
           
           for (int i = 0; i < 5; i++) {
-            if (colored_count < 8192) {
-              colored[colored_count].lane = -13;  // Perfect color
-              colored[colored_count].pos = (size_t)hit_y * (size_t)(cols + 1) + (size_t)(left_x + i);
-              colored_count++;
-            }
+            color[(size_t)hit_y * (size_t)(cols + 1) + (size_t)(left_x + i)] = -13;  // Perfect color
           }
         }
       } else if (effect_type == 2) {
@@ -345,11 +392,7 @@ void draw_frame(const ChordVec *chords, size_t cursor, double t,
           screen[(size_t)hit_y * (size_t)(cols + 1) + (size_t)(left_x + 4)] = '-';
           
           for (int i = 0; i < 5; i++) {
-            if (colored_count < 8192) {
-              colored[colored_count].lane = -12;  // Good color
-              colored[colored_count].pos = (size_t)hit_y * (size_t)(cols + 1) + (size_t)(left_x + i);
-              colored_count++;
-            }
+            color[(size_t)hit_y * (size_t)(cols + 1) + (size_t)(left_x + i)] = -12;  // Good color
           }
         }
       } else if (effect_type == 1) {
@@ -362,11 +405,7 @@ void draw_frame(const ChordVec *chords, size_t cursor, double t,
           screen[(size_t)hit_y * (size_t)(cols + 1) + (size_t)(left_x + 4)] = '.';
           
           for (int i = 0; i < 5; i++) {
-            if (colored_count < 8192) {
-              colored[colored_count].lane = -11;  // OK color
-              colored[colored_count].pos = (size_t)hit_y * (size_t)(cols + 1) + (size_t)(left_x + i);
-              colored_count++;
-            }
+            color[(size_t)hit_y * (size_t)(cols + 1) + (size_t)(left_x + i)] = -11;  // OK color
           }
         }
       }
@@ -389,11 +428,7 @@ void draw_frame(const ChordVec *chords, size_t cursor, double t,
         screen[(size_t)hit_y * (size_t)(cols + 1) + (size_t)(right_x + 4)] = 'X';
         
         for (int i = 0; i < 5; i++) {
-          if (colored_count < 8192) {
-            colored[colored_count].lane = -10;  // Miss color
-            colored[colored_count].pos = (size_t)hit_y * (size_t)(cols + 1) + (size_t)(right_x + i);
-            colored_count++;
-          }
+          color[(size_t)hit_y * (size_t)(cols + 1) + (size_t)(right_x + i)] = -10;  // Miss color
         }
       } else if (effect_type == 3) {
         // Perfect - burst animation
@@ -404,11 +439,7 @@ void draw_frame(const ChordVec *chords, size_t cursor, double t,
         screen[(size_t)hit_y * (size_t)(cols + 1) + (size_t)(right_x + 4)] = '=';
         
         for (int i = 0; i < 5; i++) {
-          if (colored_count < 8192) {
-            colored[colored_count].lane = -13;  // Perfect color
-            colored[colored_count].pos = (size_t)hit_y * (size_t)(cols + 1) + (size_t)(right_x + i);
-            colored_count++;
-          }
+          color[(size_t)hit_y * (size_t)(cols + 1) + (size_t)(right_x + i)] = -13;  // Perfect color
         }
       } else if (effect_type == 2) {
         // Good - star burst
@@ -419,11 +450,7 @@ void draw_frame(const ChordVec *chords, size_t cursor, double t,
         screen[(size_t)hit_y * (size_t)(cols + 1) + (size_t)(right_x + 4)] = '-';
         
         for (int i = 0; i < 5; i++) {
-          if (colored_count < 8192) {
-            colored[colored_count].lane = -12;  // Good color
-            colored[colored_count].pos = (size_t)hit_y * (size_t)(cols + 1) + (size_t)(right_x + i);
-            colored_count++;
-          }
+          color[(size_t)hit_y * (size_t)(cols + 1) + (size_t)(right_x + i)] = -12;  // Good color
         }
       } else if (effect_type == 1) {
         // OK - small burst
@@ -434,11 +461,7 @@ void draw_frame(const ChordVec *chords, size_t cursor, double t,
         screen[(size_t)hit_y * (size_t)(cols + 1) + (size_t)(right_x + 4)] = '.';
         
         for (int i = 0; i < 5; i++) {
-          if (colored_count < 8192) {
-            colored[colored_count].lane = -11;  // OK color
-            colored[colored_count].pos = (size_t)hit_y * (size_t)(cols + 1) + (size_t)(right_x + i);
-            colored_count++;
-          }
+          color[(size_t)hit_y * (size_t)(cols + 1) + (size_t)(right_x + i)] = -11;  // OK color
         }
       }
       break;  // Only show one effect at a time
@@ -469,10 +492,8 @@ void draw_frame(const ChordVec *chords, size_t cursor, double t,
       }
 
       // Store positions for coloring (use original lane for colors)
-      for (int i = 0; i < lane_w && colored_count < 8192; i++) {
-        colored[colored_count].lane = l;
-        colored[colored_count].pos = row_pos + (size_t)(x + i);
-        colored_count++;
+      for (int i = 0; i < lane_w; i++) {
+        color[row_pos + (size_t)(x + i)] = l;
       }
     }
   }
@@ -488,14 +509,10 @@ void draw_frame(const ChordVec *chords, size_t cursor, double t,
       screen[pos] = feedback_str[i];
       
       // Color the feedback (red for late, yellow for early)
-      if (colored_count < 8192) {
-        if (strstr(timing_feedback, "LATE")) {
-          colored[colored_count].lane = -10;  // Red (miss color)
-        } else {
-          colored[colored_count].lane = -12;  // Yellow (good color) 
-        }
-        colored[colored_count].pos = pos;
-        colored_count++;
+      if (strstr(timing_feedback, "LATE")) {
+        color[pos] = -10;  // Red (miss color)
+      } else {
+        color[pos] = -12;  // Yellow (good color)
       }
     }
   }
@@ -517,26 +534,25 @@ void draw_frame(const ChordVec *chords, size_t cursor, double t,
         size_t pos = (size_t)y * (size_t)(cols + 1) + (size_t)x;
         screen[pos] = '|';
         // Store position and lane for coloring the guide
-        if (colored_count < 8192) {
-          colored[colored_count].lane = l;
-          colored[colored_count].pos = pos;
-          colored_count++;
-        }
+        color[pos] = l;
       }
     }
   }
 
-  // notes within lookahead - mark them and store for coloring
-  for (size_t k = cursor; k < chords->n; k++) {
-    double dt = chords->v[k].t_sec - t;
-    double duration = chords->v[k].duration_sec;
+  // notes within lookahead - mark them and store for coloring. The interval
+  // index gives the first chord whose head or sustain is still on screen.
+  const double past = VISIBLE_PAST_US / 1e6;
+  for (size_t k = cv_first_active(chords, t_us - VISIBLE_PAST_US); k < chords->n; k++) {
+    // Integer difference first, so float precision does not depend on how
+    // far into the song we are
+    double dt = (double)(chords->t_us[k] - t_us) / 1e6;
+    double duration = (double)(chords->end_us[k] - chords->t_us[k]) / 1e6;
     
     // Check if either the note head OR the sustain end is visible
-    double sustain_end_time = chords->v[k].t_sec + duration;
-    double sustain_dt = sustain_end_time - t;
+    double sustain_dt = dt + duration;
     
     // Skip if note is too far past AND sustain has ended
-    if (dt < -0.3 && sustain_dt < -0.3)
+    if (dt < -past && sustain_dt < -past)
       continue;
     // Skip if BOTH note head AND sustain end haven't appeared yet
     if (dt > lookahead && sustain_dt > lookahead)
@@ -550,14 +566,14 @@ void draw_frame(const ChordVec *chords, size_t cursor, double t,
     if (y > hit_y - 1)
       y = hit_y - 1;
 
-    uint8_t m = chords->v[k].mask;
-    uint8_t is_hopo = chords->v[k].is_hopo;
+    uint8_t m = chords->mask[k];
+    uint8_t is_hopo = chords->is_hopo[k];
     
     // Draw sustain trails first (if duration > 0)
     if (duration > 0.01) {  // Only draw trail if sustain is > 10ms
       // Draw trail if any part of the sustain is visible
       // (either note head is visible, or sustain hasn't ended yet)
-      if (sustain_dt >= -0.3) {
+      if (sustain_dt >= -past) {
         // Calculate sustain end position (may be off-screen above)
         double sustain_frac = 1.0 - (sustain_dt / lookahead);
         int sustain_y = top_y + (int)(sustain_frac * (double)(h - 1));
@@ -595,11 +611,7 @@ void draw_frame(const ChordVec *chords, size_t cursor, double t,
                 screen[trail_pos] = '|';  // Trail character
                 
                 // Color the trail
-                if (colored_count < 8192) {
-                  colored[colored_count].lane = l;
-                  colored[colored_count].pos = trail_pos;
-                  colored_count++;
-                }
+                color[trail_pos] = l;
               }
             }
           }
@@ -631,10 +643,8 @@ void draw_frame(const ChordVec *chords, size_t cursor, double t,
           }
 
           // Store positions and lane for coloring (notes are brighter/bolder)
-          for (int i = 0; i < lane_w && colored_count < 8192; i++) {
-            colored[colored_count].lane = l;
-            colored[colored_count].pos = row_pos + (size_t)(x + i);
-            colored_count++;
+          for (int i = 0; i < lane_w; i++) {
+            color[row_pos + (size_t)(x + i)] = l;
           }
         }
       }
@@ -685,11 +695,7 @@ void draw_frame(const ChordVec *chords, size_t cursor, double t,
             size_t pos = (size_t)screen_y * (size_t)(cols + 1) + (size_t)screen_x;
             screen[pos] = ch;
             
-            if (colored_count < 8192) {
-              colored[colored_count].lane = color_code;
-              colored[colored_count].pos = pos;
-              colored_count++;
-            }
+            color[pos] = color_code;
           }
         }
       }
@@ -705,10 +711,8 @@ void draw_frame(const ChordVec *chords, size_t cursor, double t,
     if (flame_start_y < top_y) flame_start_y = top_y;
     if (flame_end_y > hit_y) flame_end_y = hit_y;
     
-    // Use time for flame animation cycle
-    static double flame_time = 0.0;
-    flame_time += 0.016;  // Approximate 60fps
-    int flame_frame = ((int)(flame_time * 10)) % 4;  // Cycle through 4 frames quickly
+    // Flame animation cycle, clocked by the simulation rather than frames
+    int flame_frame = ((int)(g_flame_time * 10)) % 4;  // Cycle through 4 frames quickly
     
     for (int l = 0; l < lanes; l++) {
       if (g_sustain_flames & (1u << l)) {
@@ -733,11 +737,7 @@ void draw_frame(const ChordVec *chords, size_t cursor, double t,
             size_t pos = (size_t)y * (size_t)(cols + 1) + (size_t)left_flame_x;
             screen[pos] = flame_char;
             
-            if (colored_count < 8192) {
-              colored[colored_count].lane = l;  // Use lane color
-              colored[colored_count].pos = pos;
-              colored_count++;
-            }
+            color[pos] = l;  // Use lane color
           }
           
           // Right flame
@@ -745,76 +745,42 @@ void draw_frame(const ChordVec *chords, size_t cursor, double t,
             size_t pos = (size_t)y * (size_t)(cols + 1) + (size_t)right_flame_x;
             screen[pos] = flame_char;
             
-            if (colored_count < 8192) {
-              colored[colored_count].lane = l;  // Use lane color
-              colored[colored_count].pos = pos;
-              colored_count++;
-            }
+            color[pos] = l;  // Use lane color
           }
         }
       }
     }
   }
 
-  // blit with colors
-  // Position cursor at row 1
-  printf("\x1b[1;1H"); // Position at row 1, column 1
+  // Blit: one escape per color run instead of per cell, built in a reused
+  // buffer and written with a single fwrite
+  size_t out_len = 0;
+  char *out = g_out;
+  const char *home = "\x1b[1;1H";  // Row 1, column 1
+  memcpy(out, home, strlen(home));
+  out_len += strlen(home);
 
-  // Print all rows with color lookup (starting from row 1 to skip row 0)
+  // Print all rows (starting from row 1 to skip row 0)
   for (int r = 1; r < rows; r++) {
     size_t row_start = (size_t)r * (size_t)(cols + 1);
-    int col = 0;
-    while (col < cols) {
-      // Check if this position needs coloring
-      int lane = -1;
-      for (int i = 0; i < colored_count; i++) {
-        if (colored[i].pos == row_start + (size_t)col) {
-          lane = colored[i].lane;
-          break;
-        }
-      }
-
-      if (lane >= -13 && lane <= -10) {
-        // Effect coloring (-10 to -13)
-        int effect_type = -10 - lane;
-        const char *color;
-        if (effect_type == 0) {
-          color = "\x1b[1;31m"; // Miss - bright red
-        } else if (effect_type == 3) {
-          color = "\x1b[1;33m"; // Perfect - bright yellow
-        } else if (effect_type == 2) {
-          color = "\x1b[1;32m"; // Good - bright green
-        } else {
-          color = "\x1b[1;36m"; // OK - bright cyan
-        }
-        printf("%s%c" COLOR_RESET, color, screen[row_start + (size_t)col]);
-      } else if (lane == -20) {
-        // Empty streak bar - gray
-        printf("\x1b[2;37m%c" COLOR_RESET, screen[row_start + (size_t)col]);
-      } else if (lane == -24) {
-        // 1x multiplier - blue
-        printf("\x1b[1;34m%c" COLOR_RESET, screen[row_start + (size_t)col]);
-      } else if (lane == -21) {
-        // 2x multiplier - green
-        printf("\x1b[1;32m%c" COLOR_RESET, screen[row_start + (size_t)col]);
-      } else if (lane == -22) {
-        // 3x multiplier - magenta
-        printf("\x1b[1;35m%c" COLOR_RESET, screen[row_start + (size_t)col]);
-      } else if (lane == -23) {
-        // 4x multiplier - yellow
-        printf("\x1b[1;33m%c" COLOR_RESET, screen[row_start + (size_t)col]);
-      } else if (lane >= 0) {
-        // Print colored character
-        printf("%s%c" COLOR_RESET, lane_color(lane),
-               screen[row_start + (size_t)col]);
-      } else {
-        // Print normal character
-        putchar(screen[row_start + (size_t)col]);
+    int cur = COLOR_CODE_NONE;
+    for (int col = 0; col < cols; col++) {
+      int code = color[row_start + (size_t)col];
+      if (code != cur) {
+        const char *esc = (code == COLOR_CODE_NONE) ? COLOR_RESET : color_code_escape(code);
+        size_t n = strlen(esc);
+        memcpy(out + out_len, esc, n);
+        out_len += n;
+        cur = code;
       }
-      col++;
+      out[out_len++] = screen[row_start + (size_t)col];
+    }
+    if (cur != COLOR_CODE_NONE) {
+      memcpy(out + out_len, COLOR_RESET, sizeof(COLOR_RESET) - 1);
+      out_len += sizeof(COLOR_RESET) - 1;
     }
-    putchar('\n');
+    out[out_len++] = '\n';
   }
+  fwrite(out, 1, out_len, stdout);
   fflush(stdout);
-  free(screen);
 }
@@ -47,7 +47,8 @@ void update_effects(double dt);
 void add_multiline_effect(int x, int y, int type, double duration, int width, int height);
 void update_multiline_effects(double dt);
 void set_sustain_flames(uint8_t lane_mask);
-void draw_frame(const ChordVec *chords, size_t cursor, double t,
+void set_hud_line(const char *text);  // NULL or "" hides the debug line
+void draw_frame(const ChordVec *chords, int64_t t_us,
                 double lookahead, uint8_t held_mask, const Stats *st,
                 double song_offset_ms, double global_offset_ms, 
                 int selected_track, const TrackNameVec *track_names,